@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mitkIOUtil.h>
+#include <mitkImage.h>
+#include <mitkUnstructuredGrid.h>
+#include <tinyxml.h>
+
+#include "MaterialMappingHelper.h"
+
+/*
+ * Headless material mapping. Maps one subject (-i, -m, -o) or every subject of a job list (-l) with the parameter
+ * file written by the material mapping view. See printUsage.
+ */
+
+namespace {
+    struct Parameters {
+        BoneDensityFunctor densityFunctor;
+        PowerLawFunctor powerLawFunctor;
+        float minElementValue = 0;
+        MaterialMappingFilter::Method method = MaterialMappingFilter::Method::New;
+    };
+
+    struct Subject {
+        std::string image;
+        std::string mesh;
+        std::string output;
+    };
+
+    struct Report {
+        Subject subject;
+        bool succeeded = false;
+        std::string error;
+        std::size_t nodes = 0;
+        std::size_t elements = 0;
+        double loadSeconds = 0;
+        double mappingSeconds = 0;
+        double saveSeconds = 0;
+        std::vector<MaterialMappingJob::Stage> stages;
+
+        double getSeconds() const {
+            return loadSeconds + mappingSeconds + saveSeconds;
+        }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    double getSecondsSince(Clock::time_point _start) {
+        return std::chrono::duration<double>(Clock::now() - _start).count();
+    }
+
+    void printUsage(const char *_name) {
+        std::cout << "usage: " << _name << " -p <parameters.matmap> (-i <ct> -m <mesh.vtu> -o <output> | -l <jobs.txt>)"
+                  << " [-j <jobs>] [--method old|new|distance] [-r <report.csv>] [-v]\n"
+                  << "\n"
+                  << "  -p, --parameters  parameter file saved by the material mapping view\n"
+                  << "  -i, --image       CT image\n"
+                  << "  -m, --mesh        volume mesh\n"
+                  << "  -o, --output      mapped mesh, .vtu or .txt (ASCII ugrid)\n"
+                  << "  -l, --job-list    one subject per line: <ct> <mesh> <output>, # starts a comment\n"
+                  << "  -j, --jobs        number of subjects mapped in parallel (default 1). Each mapping is\n"
+                  << "                    multi-threaded already, more jobs mainly overlap file I/O.\n"
+                  << "      --method      mapping method (default new)\n"
+                  << "  -r, --report      write the timing report as CSV\n"
+                  << "  -v, --verbose     report the duration of each stage of the mapping\n";
+    }
+
+    bool parseMethod(const std::string &_name, MaterialMappingFilter::Method &_method) {
+        if (_name == "old") {
+            _method = MaterialMappingFilter::Method::Old;
+        } else if (_name == "new") {
+            _method = MaterialMappingFilter::Method::New;
+        } else if (_name == "distance") {
+            _method = MaterialMappingFilter::Method::DistanceTransform;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * Reads the parameter file of MaterialMappingView::saveParametersButtonClicked. The view stores the fitted line in
+     * the RhoCT element if automatic fit is enabled, so the calibration data points are not needed here.
+     */
+    bool loadParameters(const std::string &_filename, Parameters &_parameters) {
+        TiXmlDocument doc(_filename.c_str());
+        if (!doc.LoadFile()) {
+            std::cerr << "could not read parameter file " << _filename << ": " << doc.ErrorDesc() << std::endl;
+            return false;
+        }
+        auto root = doc.FirstChildElement("MaterialMapping");
+        auto bonedensity = root ? root->FirstChildElement("BoneDensityParameters") : nullptr;
+        auto powerlaws = root ? root->FirstChildElement("PowerLaws") : nullptr;
+        auto rhoCt = bonedensity ? bonedensity->FirstChildElement("RhoCT") : nullptr;
+        if (!rhoCt || !powerlaws) {
+            std::cerr << "invalid parameter file " << _filename << ": bone density or power law parameters missing."
+                      << std::endl;
+            return false;
+        }
+
+        double slope, offset;
+        if (rhoCt->QueryDoubleAttribute("slope", &slope) != TIXML_SUCCESS ||
+            rhoCt->QueryDoubleAttribute("offset", &offset) != TIXML_SUCCESS) {
+            std::cerr << "invalid parameter file " << _filename << ": could not read RhoCT." << std::endl;
+            return false;
+        }
+        _parameters.densityFunctor.SetRhoCt(BoneDensityParameters::RhoCt(slope, offset));
+
+        bool enabled = false;
+        auto rhoAsh = bonedensity->FirstChildElement("RhoAsh");
+        if (rhoAsh && rhoAsh->QueryBoolAttribute("enabled", &enabled) == TIXML_SUCCESS && enabled) {
+            double divisor;
+            if (rhoAsh->QueryDoubleAttribute("offset", &offset) != TIXML_SUCCESS ||
+                rhoAsh->QueryDoubleAttribute("divisor", &divisor) != TIXML_SUCCESS) {
+                std::cerr << "invalid parameter file " << _filename << ": could not read RhoAsh." << std::endl;
+                return false;
+            }
+            _parameters.densityFunctor.SetRhoAsh(BoneDensityParameters::RhoAsh(offset, divisor));
+
+            auto rhoApp = bonedensity->FirstChildElement("RhoApp");
+            if (rhoApp && rhoApp->QueryBoolAttribute("enabled", &enabled) == TIXML_SUCCESS && enabled) {
+                if (rhoApp->QueryDoubleAttribute("divisor", &divisor) != TIXML_SUCCESS) {
+                    std::cerr << "invalid parameter file " << _filename << ": could not read RhoApp." << std::endl;
+                    return false;
+                }
+                _parameters.densityFunctor.SetRhoApp(BoneDensityParameters::RhoApp(divisor));
+            }
+        }
+
+        auto numberOfLaws = 0;
+        double factor, exponent, rangeMax;
+        for (auto law = powerlaws->FirstChildElement("PowerLawParameters"); law; law = law->NextSiblingElement()) {
+            if (law->QueryDoubleAttribute("factor", &factor) != TIXML_SUCCESS ||
+                law->QueryDoubleAttribute("exponent", &exponent) != TIXML_SUCCESS ||
+                law->QueryDoubleAttribute("offset", &offset) != TIXML_SUCCESS ||
+                law->QueryDoubleAttribute("rangeMax", &rangeMax) != TIXML_SUCCESS) {
+                std::cerr << "invalid parameter file " << _filename << ": could not read power laws." << std::endl;
+                return false;
+            }
+            // the view stores "max" as the lowest value of its spin box, see PowerLawWidgetManager::createFunctor. The
+            // file has fewer digits, so the value is not compared exactly.
+            if (rangeMax <= 0.99 * std::numeric_limits<float>::lowest()) {
+                rangeMax = std::numeric_limits<float>::max();
+            }
+            _parameters.powerLawFunctor.AddPowerLaw(PowerLawParameters(factor, exponent, offset), rangeMax);
+            ++numberOfLaws;
+        }
+        if (numberOfLaws == 0) {
+            std::cerr << "invalid parameter file " << _filename << ": no power laws." << std::endl;
+            return false;
+        }
+
+        auto options = root->FirstChildElement("Options");
+        double minValue;
+        if (options && options->QueryDoubleAttribute("minValue", &minValue) == TIXML_SUCCESS) {
+            _parameters.minElementValue = static_cast<float>(minValue);
+        }
+        return true;
+    }
+
+    bool loadJobList(const std::string &_filename, std::vector<Subject> &_subjects) {
+        std::ifstream file(_filename);
+        if (!file) {
+            std::cerr << "could not read job list " << _filename << std::endl;
+            return false;
+        }
+
+        std::string line;
+        for (auto lineNumber = 1; std::getline(file, line); ++lineNumber) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream columns(line);
+            Subject subject;
+            if (!(columns >> subject.image)) {
+                continue; // empty line or comment
+            }
+            std::string extra;
+            if (!(columns >> subject.mesh >> subject.output) || (columns >> extra)) {
+                std::cerr << _filename << ":" << lineNumber << ": expected <ct> <mesh> <output>" << std::endl;
+                return false;
+            }
+            _subjects.push_back(subject);
+        }
+        return true;
+    }
+
+    template<class TData>
+    typename TData::Pointer loadData(const std::string &_filename) {
+        for (const auto &data : mitk::IOUtil::Load(_filename)) {
+            typename TData::Pointer result = dynamic_cast<TData *>(data.GetPointer());
+            if (result) {
+                return result;
+            }
+        }
+        throw std::runtime_error("no " + std::string(TData::GetStaticNameOfClass()) + " in " + _filename);
+    }
+
+    /*
+     * MITK readers and writers are not guaranteed to be thread safe, so file I/O of parallel jobs is serialized. The
+     * time spent waiting is not part of the report.
+     */
+    std::mutex ioMutex;
+
+    Report processSubject(const Subject &_subject, const Parameters &_parameters) {
+        Report report;
+        report.subject = _subject;
+        std::mutex stagesMutex;
+
+        try {
+            mitk::Image::Pointer image;
+            mitk::UnstructuredGrid::Pointer mesh;
+            {
+                std::lock_guard<std::mutex> lock(ioMutex);
+                auto start = Clock::now();
+                image = loadData<mitk::Image>(_subject.image);
+                mesh = loadData<mitk::UnstructuredGrid>(_subject.mesh);
+                report.loadSeconds = getSecondsSince(start);
+            }
+            report.nodes = mesh->GetVtkUnstructuredGrid()->GetNumberOfPoints();
+            report.elements = mesh->GetVtkUnstructuredGrid()->GetNumberOfCells();
+
+            auto start = Clock::now();
+            auto result = MaterialMappingHelper::Compute(mesh,
+                                                         image,
+                                                         _parameters.method,
+                                                         _parameters.densityFunctor,
+                                                         _parameters.powerLawFunctor,
+                                                         _parameters.minElementValue,
+                                                         nullptr, // no E image cache, the subjects rarely share a CT
+                                                         [&](const MaterialMappingJob::Stage &_stage) {
+                                                             std::lock_guard<std::mutex> lock(stagesMutex);
+                                                             report.stages.push_back(_stage);
+                                                         });
+            report.mappingSeconds = getSecondsSince(start);
+
+            {
+                std::lock_guard<std::mutex> lock(ioMutex);
+                auto start = Clock::now();
+                mitk::IOUtil::Save(result, _subject.output);
+                report.saveSeconds = getSecondsSince(start);
+            }
+            report.succeeded = true;
+        } catch (const std::exception &e) {
+            report.error = e.what();
+        }
+        return report;
+    }
+
+    void printReport(const Report &_report, bool _verbose) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2);
+        if (_report.succeeded) {
+            out << _report.subject.output << ": " << _report.nodes << " nodes, " << _report.elements
+                << " elements, load " << _report.loadSeconds << "s, mapping " << _report.mappingSeconds << "s, save "
+                << _report.saveSeconds << "s\n";
+        } else {
+            out << _report.subject.output << ": FAILED: " << _report.error << "\n";
+        }
+        if (_verbose) {
+            for (const auto &stage : _report.stages) {
+                out << "    " << std::left << std::setw(12) << stage.name << std::right << std::setw(10)
+                    << stage.seconds << "s" << std::setw(14) << std::setprecision(0) << stage.getThroughput()
+                    << " items/s\n" << std::setprecision(2);
+            }
+        }
+        std::cout << out.str() << std::flush;
+    }
+
+    bool writeReport(const std::string &_filename, const std::vector<Report> &_reports) {
+        std::ofstream file(_filename);
+        if (!file) {
+            std::cerr << "could not write report " << _filename << std::endl;
+            return false;
+        }
+
+        file << "image,mesh,output,status,nodes,elements,load [s],mapping [s],save [s],total [s]\n";
+        for (const auto &report : _reports) {
+            file << report.subject.image << "," << report.subject.mesh << "," << report.subject.output << ","
+                 << (report.succeeded ? "ok" : "failed") << "," << report.nodes << "," << report.elements << ","
+                 << report.loadSeconds << "," << report.mappingSeconds << "," << report.saveSeconds << ","
+                 << report.getSeconds() << "\n";
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string parameterFile, jobList, reportFile;
+    Subject single;
+    Parameters parameters;
+    auto numberOfJobs = 1;
+    auto verbose = false;
+
+    for (auto i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        auto hasValue = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (arg == "-v" || arg == "--verbose") {
+            verbose = true;
+        } else if (!hasValue) {
+            std::cerr << "missing value for " << arg << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        } else if (arg == "-p" || arg == "--parameters") {
+            parameterFile = argv[++i];
+        } else if (arg == "-i" || arg == "--image") {
+            single.image = argv[++i];
+        } else if (arg == "-m" || arg == "--mesh") {
+            single.mesh = argv[++i];
+        } else if (arg == "-o" || arg == "--output") {
+            single.output = argv[++i];
+        } else if (arg == "-l" || arg == "--job-list") {
+            jobList = argv[++i];
+        } else if (arg == "-r" || arg == "--report") {
+            reportFile = argv[++i];
+        } else if (arg == "-j" || arg == "--jobs") {
+            numberOfJobs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--method") {
+            if (!parseMethod(argv[++i], parameters.method)) {
+                std::cerr << "unknown method " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else {
+            std::cerr << "unknown argument " << arg << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto hasSingle = !single.image.empty() && !single.mesh.empty() && !single.output.empty();
+    if (parameterFile.empty() || hasSingle == !jobList.empty()) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!loadParameters(parameterFile, parameters)) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Subject> subjects;
+    if (hasSingle) {
+        subjects.push_back(single);
+    } else if (!loadJobList(jobList, subjects)) {
+        return EXIT_FAILURE;
+    }
+
+    // subjects are handed out in order, reports are printed as soon as a subject is done
+    std::vector<Report> reports(subjects.size());
+    std::atomic<std::size_t> next(0);
+    std::mutex printMutex;
+    auto worker = [&]() {
+        for (auto i = next++; i < subjects.size(); i = next++) {
+            reports[i] = processSubject(subjects[i], parameters);
+            std::lock_guard<std::mutex> lock(printMutex);
+            printReport(reports[i], verbose);
+        }
+    };
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    auto numberOfThreads = std::min<std::size_t>(numberOfJobs, subjects.size());
+    for (std::size_t i = 0; i < numberOfThreads; ++i) {
+        threads.push_back(std::thread(worker));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    auto failed = std::count_if(reports.begin(), reports.end(), [](const Report &_report) {
+        return !_report.succeeded;
+    });
+    std::cout << std::fixed << std::setprecision(2) << subjects.size() - failed << " of " << subjects.size()
+              << " subjects mapped in " << getSecondsSince(start) << "s" << std::endl;
+
+    if (!reportFile.empty() && !writeReport(reportFile, reports)) {
+        return EXIT_FAILURE;
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
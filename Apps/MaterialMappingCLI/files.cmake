@@ -0,0 +1,25 @@
+set(MATERIALMAPPING_CPP_FILES
+  BoneDensityFunctor.cpp
+  BoneDensityParameters.cpp
+  DistanceTransform.cpp
+  ElasticityImageCache.cpp
+  ElasticityKernel.cpp
+  ExtendImageKernel.cpp
+  ExtendSurfaceKernel.cpp
+  MaterialMappingFilter.cpp
+  MaterialMappingHelper.cpp
+  MaterialMappingJob.cpp
+  PowerLawFunctor.cpp
+  PowerLawParameters.cpp
+  TetraQuadrature.cpp
+  TetraVoxelizer.cpp
+  VerboseImageWriter.cpp
+)
+
+set(CPP_FILES
+  MaterialMappingCLI.cpp
+)
+
+foreach(file ${MATERIALMAPPING_CPP_FILES})
+  set(CPP_FILES ${CPP_FILES} ${MATERIALMAPPING_SOURCE_DIR}/${file})
+endforeach(file ${MATERIALMAPPING_CPP_FILES})
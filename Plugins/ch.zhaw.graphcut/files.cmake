@@ -8,6 +8,7 @@ set(INTERNAL_CPP_FILES
   lib/GraphCut3D/lib/kolmogorov-3.03/maxflow.cpp
   GraphcutView.cpp
   GraphcutWorker.cpp
+  GraphcutJobQueue.cpp
 )
 
 set(UI_FILES
@@ -18,6 +19,7 @@ set(MOC_H_FILES
   src/internal/ch_zhaw_graphcut_Activator.h
   src/internal/GraphcutView.h
   src/internal/Worker.h
+  src/internal/GraphcutJobQueue.h
 )
 
 # list of resource files which can be used by the plug-in
@@ -0,0 +1,97 @@
+/**
+ *  MITK-GEM: Graphcut Plugin
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+#include <algorithm>
+
+// Qt
+#include <QThreadPool>
+
+// MITK
+#include <mitkLogMacros.h>
+
+#include "GraphcutJobQueue.h"
+
+GraphcutJobQueue::GraphcutJobQueue(QObject *parent)
+        : QObject(parent)
+        , m_runningMemoryInBytes(0)
+        , m_maximumConcurrentJobs(1)
+        , m_memoryBudgetInBytes(4096000000)
+{
+}
+
+GraphcutJobQueue::~GraphcutJobQueue(){
+    for(const Job &job : m_waiting){
+        delete job.worker;
+    }
+}
+
+void GraphcutJobQueue::enqueue(Worker *worker, unsigned int workerId, double predictedMemoryInBytes){
+    MITK_INFO("ch.zhaw.graphcut") << "queue worker " << workerId << " (" << predictedMemoryInBytes / 1024.0 / 1024.0 << "MB)";
+    m_waiting.push_back({worker, workerId, predictedMemoryInBytes});
+    schedule();
+    emit queueChanged();
+}
+
+void GraphcutJobQueue::setMaximumConcurrentJobs(unsigned int i){
+    m_maximumConcurrentJobs = std::max(1u, i);
+    schedule();
+    emit queueChanged();
+}
+
+void GraphcutJobQueue::setMemoryBudget(double bytes){
+    m_memoryBudgetInBytes = bytes;
+    schedule();
+    emit queueChanged();
+}
+
+unsigned int GraphcutJobQueue::getQueuePosition(unsigned int workerId) const{
+    for(unsigned int i = 0; i < m_waiting.size(); ++i){
+        if(m_waiting[i].id == workerId){
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+std::vector<unsigned int> GraphcutJobQueue::getWaitingJobs() const{
+    std::vector<unsigned int> ids;
+    for(const Job &job : m_waiting){
+        ids.push_back(job.id);
+    }
+    return ids;
+}
+
+void GraphcutJobQueue::jobFinished(unsigned int workerId){
+    auto it = m_running.find(workerId);
+    if(it != m_running.end()){
+        m_runningMemoryInBytes -= it->second;
+        m_running.erase(it);
+    }
+    schedule();
+    emit queueChanged();
+}
+
+void GraphcutJobQueue::schedule(){
+    // strictly first in, first out. a large job at the front is not overtaken by smaller ones
+    while(!m_waiting.empty() && m_running.size() < m_maximumConcurrentJobs){
+        const Job &job = m_waiting.front();
+        bool fitsIntoBudget = m_runningMemoryInBytes + job.predictedMemoryInBytes <= m_memoryBudgetInBytes;
+        if(!fitsIntoBudget && !m_running.empty()){
+            break;
+        }
+
+        MITK_INFO("ch.zhaw.graphcut") << "start worker " << job.id;
+        m_running[job.id] = job.predictedMemoryInBytes;
+        m_runningMemoryInBytes += job.predictedMemoryInBytes;
+
+        // QThreadPool will take care of the deconstruction of the worker once it has finished
+        QThreadPool::globalInstance()->start(job.worker, QThread::HighestPriority);
+        m_waiting.pop_front();
+    }
+}
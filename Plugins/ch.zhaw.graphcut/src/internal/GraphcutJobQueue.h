@@ -0,0 +1,81 @@
+/**
+ *  MITK-GEM: Graphcut Plugin
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+#ifndef __GraphcutJobQueue_h__
+#define __GraphcutJobQueue_h__
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <QObject>
+
+#include "Worker.h"
+
+/*!
+ * First in, first out queue for graphcut workers.
+ *
+ * A worker is admitted to the global QThreadPool once fewer than maximumConcurrentJobs are running and its predicted
+ * memory fits into the remaining memory budget. A job exceeding the budget on its own still runs, but only while
+ * nothing else is running.
+ */
+class GraphcutJobQueue : public QObject {
+    Q_OBJECT
+
+public:
+    GraphcutJobQueue(QObject *parent = nullptr);
+
+    // deletes the workers that are still waiting. running ones belong to the QThreadPool
+    ~GraphcutJobQueue();
+
+    // takes ownership of the worker until it is handed to the QThreadPool
+    void enqueue(Worker *worker, unsigned int workerId, double predictedMemoryInBytes);
+
+    void setMaximumConcurrentJobs(unsigned int i);
+    void setMemoryBudget(double bytes);
+
+    unsigned int getNumberOfRunningJobs() const {
+        return m_running.size();
+    }
+
+    unsigned int getNumberOfWaitingJobs() const {
+        return m_waiting.size();
+    }
+
+    // 1 based position in the queue. 0 if the job is not waiting
+    unsigned int getQueuePosition(unsigned int workerId) const;
+
+    // ids of the waiting jobs in queue order
+    std::vector<unsigned int> getWaitingJobs() const;
+
+    signals:
+    // emitted whenever a job is added, started or finished
+    void queueChanged();
+
+public slots:
+    void jobFinished(unsigned int workerId);
+
+private:
+    struct Job {
+        Worker *worker;
+        unsigned int id;
+        double predictedMemoryInBytes;
+    };
+
+    void schedule();
+
+    std::deque<Job> m_waiting;
+    std::map<unsigned int, double> m_running; // worker id -> predicted memory
+    double m_runningMemoryInBytes;
+
+    unsigned int m_maximumConcurrentJobs;
+    double m_memoryBudgetInBytes;
+};
+
+#endif // __GraphcutJobQueue_h__
@@ -24,12 +24,12 @@
 #include <mitkTimeGeometry.h>
 
 // Qt
-#include <QThreadPool>
 #include <QMessageBox>
 
 // Graphcut
 #include "lib/GraphCut3D/ImageGraphCut3DFilter.h"
 #include "GraphcutWorker.h"
+#include "GraphcutJobQueue.h"
 
 
 const std::string GraphcutView::VIEW_ID = "org.mitk.views.imagegraphcut3dsegmentation";
@@ -51,17 +51,27 @@ void GraphcutView::CreateQtPartControl(QWidget *parent) {
     m_Controls.foregroundImageSelector->SetPredicate(WorkbenchUtils::createIsBinaryImageTypePredicate());
     m_Controls.backgroundImageSelector->SetPredicate(WorkbenchUtils::createIsBinaryImageTypePredicate());
 
+    // job queue
+    m_jobQueue = new GraphcutJobQueue(this);
+    queueParametersChanged();
+
     // setup signals
+    connect(m_jobQueue, SIGNAL(queueChanged()), this, SLOT(updateQueueStatus()));
+    connect(m_Controls.paramConcurrentJobsSpinBox, SIGNAL(valueChanged(int)), this, SLOT(queueParametersChanged()));
+    connect(m_Controls.paramMemoryBudgetSpinBox, SIGNAL(valueChanged(int)), this, SLOT(queueParametersChanged()));
     connect(m_Controls.startButton, SIGNAL(clicked()), this, SLOT(startButtonPressed()));
     connect(m_Controls.refreshTimeButton, SIGNAL(clicked()), this, SLOT(refreshButtonPressed()));
     connect(m_Controls.refreshMemoryButton, SIGNAL(clicked()), this, SLOT(refreshButtonPressed()));
     connect(m_Controls.greyscaleImageSelector, SIGNAL(OnSelectionChanged (const mitk::DataNode *)), this, SLOT(imageSelectionChanged()));
     connect(m_Controls.foregroundImageSelector, SIGNAL(OnSelectionChanged (const mitk::DataNode *)), this, SLOT(imageSelectionChanged()));
     connect(m_Controls.backgroundImageSelector, SIGNAL(OnSelectionChanged (const mitk::DataNode *)), this, SLOT(imageSelectionChanged()));
+    connect(m_Controls.paramSupervoxelCheckBox, SIGNAL(toggled(bool)), this, SLOT(refreshButtonPressed()));
+    connect(m_Controls.paramSupervoxelSizeSpinBox, SIGNAL(valueChanged(int)), this, SLOT(refreshButtonPressed()));
 
     // init default state
     m_currentlyActiveWorkerCount = 0;
     lockGui(false);
+    updateQueueStatus();
 }
 
 void GraphcutView::OnSelectionChanged(berry::IWorkbenchPart::Pointer, const QList <mitk::DataNode::Pointer> &) {
@@ -84,7 +94,7 @@ void GraphcutView::startButtonPressed() {
         mitk::Image::Pointer foregroundMask = dynamic_cast<mitk::Image *>(foregroundMaskNode->GetData());
         mitk::Image::Pointer backgroundMask = dynamic_cast<mitk::Image *>(backgroundMaskNode->GetData());
 
-        // create worker. QThreadPool will take care of the deconstruction of the worker once it has finished
+        // create worker. the job queue hands it to the QThreadPool, which will take care of the deconstruction of the worker once it has finished
         MITK_INFO("ch.zhaw.graphcut") << "create the worker";
         GraphcutWorker *worker = new GraphcutWorker();
 
@@ -107,6 +117,11 @@ void GraphcutView::startButtonPressed() {
         worker->setSigma(m_Controls.paramSigmaSpinBox->value());
         worker->setBoundaryDirection((GraphcutWorker::BoundaryDirection) m_Controls.paramBoundaryDirectionComboBox->currentIndex());
         worker->setForegroundPixelValue(m_Controls.paramLabelValueSpinBox->value());
+        worker->setUseSupervoxels(m_Controls.paramSupervoxelCheckBox->isChecked());
+        worker->setSupervoxelSize(m_Controls.paramSupervoxelSizeSpinBox->value());
+        worker->setSupervoxelCompactness(m_Controls.paramSupervoxelCompactnessSpinBox->value());
+        worker->setAutomaticCropping(m_Controls.paramCroppingCheckBox->isChecked());
+        worker->setCroppingMargin(m_Controls.paramCroppingMarginSpinBox->value());
 
         // set up signals
         MITK_INFO("ch.zhaw.graphcut") << "register signals";
@@ -117,18 +132,26 @@ void GraphcutView::startButtonPressed() {
 
         // prepare the progress bar
         MITK_INFO("ch.zhaw.graphcut") << "prepare GUI";
-        m_Controls.progressBar->setValue(0);
         m_Controls.progressBar->setMinimum(0);
         m_Controls.progressBar->setMaximum(100);
 
-        MITK_INFO("ch.zhaw.graphcut") << "start the worker";
-        QThreadPool::globalInstance()->start(worker, QThread::HighestPriority);
+        long long numberOfEdges;
+        double memoryRequiredInBytes = estimateMemoryRequirements(greyscaleImage, numberOfEdges);
+
+        MITK_INFO("ch.zhaw.graphcut") << "queue the worker";
+        unsigned int workerId = worker->id;
+        m_jobQueue->enqueue(worker, workerId, memoryRequiredInBytes);
+        if(unsigned int position = m_jobQueue->getQueuePosition(workerId)){
+            MITK_INFO("ch.zhaw.graphcut") << "worker " << workerId << " is waiting at position " << position;
+        }
     }
 }
 
 void GraphcutView::workerHasStarted(unsigned int workerId) {
     MITK_DEBUG("ch.zhaw.graphcut") << "worker " << workerId << " started";
-    m_currentlyActiveWorkerCount++;
+    if(m_currentlyActiveWorkerCount++ == 0){
+        m_Controls.progressBar->setValue(0);
+    }
     lockGui(true);
 }
 
@@ -158,6 +181,7 @@ void GraphcutView::workerIsDone(itk::DataObject::Pointer data, unsigned int work
     if(--m_currentlyActiveWorkerCount == 0){ // no more active workers
         lockGui(false);
     }
+    m_jobQueue->jobFinished(workerId);
     mitk::RenderingManager::GetInstance()->RequestUpdateAll();
 }
 
@@ -167,36 +191,55 @@ void GraphcutView::imageSelectionChanged() {
     // estimate required memory and computation time
     mitk::DataNode *greyscaleImageNode = m_Controls.greyscaleImageSelector->GetSelectedNode();
     if(greyscaleImageNode){
-        // numberOfVertices is straightforward
         mitk::Image::Pointer greyscaleImage = dynamic_cast<mitk::Image *>(greyscaleImageNode->GetData());
-        auto x = greyscaleImage->GetDimension(0);
-        auto y = greyscaleImage->GetDimension(1);
-        auto z = greyscaleImage->GetDimension(2);
-        auto numberOfVertices = x*y*z;
-
-        // numberOfEdges are a bit more tricky
-        auto numberOfEdges = 3; // 3 because we're using a 6-connected neighborhood which gives us 3 edges / pixel
-        numberOfEdges = (numberOfEdges * x) - 1;
-        numberOfEdges = (numberOfEdges * y) - x;
-        numberOfEdges = (numberOfEdges * z) - x * y;
-        numberOfEdges *= 2; // because kolmogorov adds 2 directed edges instead of 1 bidirectional
-
-        // the input image will be cast to short
-        auto itkImageSizeInMemory = numberOfVertices * sizeof(short);
-
-        // both mask are cast to unsigned chars
-        itkImageSizeInMemory += (2 * numberOfVertices * sizeof(unsigned char));
-
-        // node struct is 48byte, arc is 28byte as defined by Kolmogorov max flow v3.0.03
-        auto memoryRequiredInBytes = numberOfVertices * 48 + numberOfEdges * 28 + itkImageSizeInMemory;
-
-        MITK_INFO("ch.zhaw.graphcut") << "Image has " << numberOfVertices << " vertices and " <<  numberOfEdges << " edges";
+        long long numberOfEdges;
+        double memoryRequiredInBytes = estimateMemoryRequirements(greyscaleImage, numberOfEdges);
 
         updateMemoryRequirements(memoryRequiredInBytes);
         updateTimeEstimate(numberOfEdges);
     }
 }
 
+double GraphcutView::estimateMemoryRequirements(mitk::Image *greyscaleImage, long long &numberOfEdgesOut){
+    // everything in double: the products overflow 32 bit integers for large CTs (e.g. 512x512x1500)
+    double x = greyscaleImage->GetDimension(0);
+    double y = greyscaleImage->GetDimension(1);
+    double z = greyscaleImage->GetDimension(2);
+
+    // numberOfVertices is straightforward
+    double numberOfVertices = x * y * z;
+
+    // numberOfEdges are a bit more tricky
+    double numberOfEdges = 3; // 3 because we're using a 6-connected neighborhood which gives us 3 edges / pixel
+    numberOfEdges = (numberOfEdges * x) - 1;
+    numberOfEdges = (numberOfEdges * y) - x;
+    numberOfEdges = (numberOfEdges * z) - x * y;
+    numberOfEdges *= 2; // because kolmogorov adds 2 directed edges instead of 1 bidirectional
+
+    // the input image will be cast to short
+    double itkImageSizeInMemory = numberOfVertices * sizeof(short);
+
+    // both mask are cast to unsigned chars
+    itkImageSizeInMemory += (2 * numberOfVertices * sizeof(unsigned char));
+
+    // node struct is 48byte, arc is 28byte as defined by Kolmogorov max flow v3.0.03
+    double memoryRequiredInBytes = numberOfVertices * 48 + numberOfEdges * 28 + itkImageSizeInMemory;
+
+    if(m_Controls.paramSupervoxelCheckBox->isChecked()){
+        // one vertex per supervoxel with about 13 neighbors each (26-connected grid) plus the 4 byte label per voxel.
+        // the refinement band is small compared to the volume and is neglected
+        double supervoxelSize = m_Controls.paramSupervoxelSizeSpinBox->value();
+        double numberOfSupervoxels = numberOfVertices / (supervoxelSize * supervoxelSize * supervoxelSize);
+        numberOfEdges = numberOfSupervoxels * 13 * 2;
+        memoryRequiredInBytes = numberOfSupervoxels * 48 + numberOfEdges * 28 + numberOfVertices * sizeof(unsigned int) + itkImageSizeInMemory;
+    }
+
+    MITK_INFO("ch.zhaw.graphcut") << "Image has " << static_cast<long long>(numberOfVertices) << " vertices and " << static_cast<long long>(numberOfEdges) << " edges";
+
+    numberOfEdgesOut = static_cast<long long>(numberOfEdges);
+    return memoryRequiredInBytes;
+}
+
 void GraphcutView::updateMemoryRequirements(double memoryRequiredInBytes){
     QString memory = QString::number(memoryRequiredInBytes / 1024.0 / 1024.0, 'f', 0);
     memory.append("MB");
@@ -331,12 +374,30 @@ bool GraphcutView::isValidSelection() {
 }
 
 void GraphcutView::lockGui(bool b) {
-    m_Controls.parentWidget->setEnabled(!b);
+    // the panel stays usable while workers are running. further jobs are queued
     m_Controls.progressBar->setVisible(b);
-    m_Controls.startButton->setVisible(!b);
     mitk::RenderingManager::GetInstance()->RequestUpdateAll();
 }
 
+void GraphcutView::queueParametersChanged(){
+    m_jobQueue->setMaximumConcurrentJobs(m_Controls.paramConcurrentJobsSpinBox->value());
+    m_jobQueue->setMemoryBudget(m_Controls.paramMemoryBudgetSpinBox->value() * 1024.0 * 1024.0);
+}
+
+void GraphcutView::updateQueueStatus(){
+    QString status;
+    if(m_jobQueue->getNumberOfRunningJobs() > 0 || m_jobQueue->getNumberOfWaitingJobs() > 0){
+        status.append(QString::number(m_jobQueue->getNumberOfRunningJobs())).append(" running");
+        std::vector<unsigned int> waiting = m_jobQueue->getWaitingJobs();
+        for(unsigned int i = 0; i < waiting.size(); ++i){
+            status.append("\njob ").append(QString::number(waiting[i]));
+            status.append(" waiting at position ").append(QString::number(i + 1));
+        }
+    }
+    m_Controls.queueStatus->setText(status);
+    m_Controls.queueStatus->setVisible(!status.isEmpty());
+}
+
 void GraphcutView::workerProgressUpdate(float progress, unsigned int){
     int progressInt = (int) (progress * 100.0f);
     m_Controls.progressBar->setValue(progressInt);
@@ -18,6 +18,8 @@
 // Utils
 #include "WorkbenchUtils.h"
 
+class GraphcutJobQueue;
+
 class GraphcutView : public QmitkAbstractView {
     Q_OBJECT
 
@@ -32,6 +34,8 @@ protected slots:
     void workerHasStarted(unsigned int);
     void workerProgressUpdate(float progress, unsigned int id);
     void workerIsDone(itk::DataObject::Pointer, unsigned int);
+    void queueParametersChanged();
+    void updateQueueStatus();
 
 protected:
     virtual void CreateQtPartControl(QWidget *parent);
@@ -44,6 +48,7 @@ protected:
     Ui::GraphcutViewControls m_Controls;
 
 private:
+    double estimateMemoryRequirements(mitk::Image *, long long &numberOfEdges);
     void updateMemoryRequirements(double memoryRequiredInBytes);
     void updateTimeEstimate(long long numberOfEdges);
     void initializeImageSelector(QmitkDataStorageComboBox *);
@@ -54,6 +59,7 @@ private:
     bool isValidSelection();
     void lockGui(bool);
     unsigned int m_currentlyActiveWorkerCount;
+    GraphcutJobQueue *m_jobQueue;
 };
 
 #endif // GraphcutView_h
@@ -17,13 +17,25 @@ GraphcutWorker::GraphcutWorker()
         : id(WorkbenchUtils::getId())
         , m_Sigma(50)
         , m_ForegroundPixelValue(255)
+        , m_UseSupervoxels(false)
+        , m_SupervoxelSize(8)
+        , m_SupervoxelCompactness(50)
+        , m_AutomaticCropping(false)
+        , m_CroppingMargin(10)
 {
 }
 
 void GraphcutWorker::preparePipeline() {
     MITK_INFO("ch.zhaw.graphcut") << "prepare pipeline...";
 
-    m_graphCut = GraphCutFilterType::New();
+    if(m_UseSupervoxels){
+        SupervoxelGraphCutFilterType::Pointer supervoxelGraphCut = SupervoxelGraphCutFilterType::New();
+        supervoxelGraphCut->SetSupervoxelSize(m_SupervoxelSize);
+        supervoxelGraphCut->SetCompactness(m_SupervoxelCompactness);
+        m_graphCut = supervoxelGraphCut.GetPointer();
+    } else{
+        m_graphCut = GraphCutFilterType::New().GetPointer();
+    }
     m_graphCut->SetInputImage(m_input);
     m_graphCut->SetForegroundImage(rescaleMask(m_foreground, m_ForegroundPixelValue));
     m_graphCut->SetBackgroundImage(rescaleMask(m_background, m_ForegroundPixelValue));
@@ -32,6 +44,8 @@ void GraphcutWorker::preparePipeline() {
     m_graphCut->SetNumberOfThreads(uiNumberOfThreads > 0 ? uiNumberOfThreads : 1);
 
     m_graphCut->SetSigma(m_Sigma);
+    m_graphCut->SetAutomaticCropping(m_AutomaticCropping);
+    m_graphCut->SetCroppingMargin(m_CroppingMargin);
     switch (m_boundaryDirection) {
         case 0:
             m_graphCut->SetBoundaryDirectionTypeToNoDirection();
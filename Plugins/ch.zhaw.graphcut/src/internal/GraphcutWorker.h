@@ -66,7 +66,9 @@ public:
     typedef itk::Image<BinaryPixelType, 3> OutputImageType;
 
     // typedef for pipeline
+    typedef itk::ImageGraphCut3DFilter<InputImageType, MaskImageType, MaskImageType, OutputImageType> GraphCutBaseFilterType;
     typedef GraphCut::FilterType<InputImageType, MaskImageType, MaskImageType, OutputImageType> GraphCutFilterType;
+    typedef GraphCut::SupervoxelFilterType<InputImageType, MaskImageType, MaskImageType, OutputImageType> SupervoxelGraphCutFilterType;
 
     GraphcutWorker();
 
@@ -106,6 +108,27 @@ public:
         m_ForegroundPixelValue = u;
     }
 
+    void setUseSupervoxels(bool b){
+        m_UseSupervoxels = b;
+    }
+
+    void setSupervoxelSize(unsigned int i){
+        m_SupervoxelSize = i;
+    }
+
+    // SLIC compactness in intensity units, independent of sigma
+    void setSupervoxelCompactness(double d){
+        m_SupervoxelCompactness = d;
+    }
+
+    void setAutomaticCropping(bool b){
+        m_AutomaticCropping = b;
+    }
+
+    void setCroppingMargin(unsigned int i){
+        m_CroppingMargin = i;
+    }
+
     unsigned int id;
 
 private:
@@ -118,13 +141,18 @@ private:
     MaskImageType::Pointer m_foreground;
     MaskImageType::Pointer m_background;
     OutputImageType::Pointer m_output;
-    GraphCutFilterType::Pointer m_graphCut;
+    GraphCutBaseFilterType::Pointer m_graphCut;
     ProgressObserverCommand::Pointer m_progressCommand;
 
     // parameters
     double m_Sigma;
     BoundaryDirection m_boundaryDirection;
     BinaryPixelType m_ForegroundPixelValue;
+    bool m_UseSupervoxels;
+    unsigned int m_SupervoxelSize;
+    double m_SupervoxelCompactness;
+    bool m_AutomaticCropping;
+    unsigned int m_CroppingMargin;
 };
 
 #endif // __GraphcutWorker_h__
@@ -7,6 +7,7 @@
 #else
 #include "ImageGraphCut3DKolmogorovFilter.hxx"
 #endif
+#include "ImageGraphCut3DSupervoxelFilter.h"
 
 namespace GraphCut
 {
@@ -16,6 +17,10 @@ namespace GraphCut
     #else
         using FilterType = itk::ImageGraphCut3DKolmogorovFilter<TInput, TForeground, TBackground, TOutput>;
     #endif // GRIDCUT_LIBRARY_AVAILABLE
+
+    // graph cut on a supervoxel adjacency graph for volumes too large for a voxel graph
+    template<typename TInput, typename TForeground, typename TBackground, typename TOutput>
+    using SupervoxelFilterType = itk::ImageGraphCut3DSupervoxelFilter<TInput, TForeground, TBackground, TOutput>;
 }
 
 #endif //__GraphCut_h__
@@ -23,6 +23,9 @@
 
 // STL
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <limits>
 
 namespace itk {
     template<typename TInput, typename TForeground, typename TBackground, typename TOutput>
@@ -95,6 +98,17 @@ namespace itk {
         void SetVerboseOutput(bool b) {
             m_PrintTimer = b;
         }
+
+        // restricts the graph to the bounding box of all seeds grown by the cropping margin. voxels outside of the box
+        // are background
+        void SetAutomaticCropping(bool b) {
+            m_AutomaticCropping = b;
+        }
+
+        // margin in voxels around the seed bounding box
+        void SetCroppingMargin(unsigned int i) {
+            m_CroppingMargin = i;
+        }
     protected:
         struct ImageContainer {
             typename InputImageType::ConstPointer input;
@@ -121,13 +135,37 @@ namespace itk {
 
         virtual void CutGraph(ImageContainer, ProgressReporter &progress) = 0;
 
-        // convert masks to >0 indices
+        // convert masks to >0 indices within the region
         template<typename TIndexImage>
-        std::vector<itk::Index<3> > getPixelsLargerThanZero(const TIndexImage *const) const;
+        std::vector<itk::Index<3> > getPixelsLargerThanZero(const TIndexImage *const, typename InputImageType::RegionType) const;
 
-        // convert 3d itk indices to a continuously numbered indices
+        // convert 3d itk indices to a continuously numbered indices, relative to the start of the region
         unsigned int ConvertIndexToVertexDescriptor(const itk::Index<3>, typename InputImageType::RegionType);
 
+        // bounding box of all voxels > 0 in both seed images, grown by m_CroppingMargin and clipped to the largest
+        // possible region. The largest possible region if there are no seeds.
+        typename InputImageType::RegionType ComputeSeedBoundingBox(const ImageContainer &) const;
+
+        // extends [min, max] by the voxels > 0 of the mask in one parallel pass
+        template<typename TMaskImage>
+        void ExpandBoundingBox(const TMaskImage *, itk::Index<3> &min, itk::Index<3> &max) const;
+
+        // boundary term of the edge between a center and a neighbor pixel.
+        // forward is the capacity center -> neighbor, backward neighbor -> center
+        template<BoundaryDirectionType TDirection>
+        static inline void ComputeEdgeWeights(double centerPixel, double neighborPixel, double sigma, WeightType &forward, WeightType &backward);
+
+        // boundary terms of the edges between a row of center pixels and a row of neighbor pixels. The boundary
+        // direction is resolved at compile time, every instantiation is a branch free loop the compiler can vectorize.
+        template<BoundaryDirectionType TDirection>
+        static void ComputeEdgeWeights(const typename InputImageType::PixelType *center, const typename InputImageType::PixelType *neighbor,
+                                       unsigned int n, double sigma, WeightType *forward, WeightType *backward);
+
+        // splits [0, n) into contiguous chunks and calls f(begin, end, threadId) for each chunk on its own thread.
+        // the number of chunks is bounded by GetNumberOfThreads()
+        template<typename TFunction>
+        void ParallelFor(unsigned int n, TFunction f) const;
+
         // image getters
         const InputImageType *GetInputImage() {
             return static_cast< const InputImageType * >(this->ProcessObject::GetInput(0));
@@ -148,6 +186,8 @@ namespace itk {
         typename OutputImageType::PixelType m_ForegroundPixelValue;
         typename OutputImageType::PixelType m_BackgroundPixelValue;
         bool m_PrintTimer;
+        bool m_AutomaticCropping;
+        unsigned int m_CroppingMargin;
 
 
     private:
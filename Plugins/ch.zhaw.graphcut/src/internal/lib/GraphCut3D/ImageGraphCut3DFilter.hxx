@@ -20,7 +20,9 @@ namespace itk {
               m_BoundaryDirectionType(NoDirection),
               m_ForegroundPixelValue(255),
               m_BackgroundPixelValue(0),
-              m_PrintTimer(false) {
+              m_PrintTimer(false),
+              m_AutomaticCropping(false),
+              m_CroppingMargin(10) {
         this->SetNumberOfRequiredInputs(3);
     }
 
@@ -44,6 +46,24 @@ namespace itk {
         images.output = this->GetOutput();
         images.outputRegion = images.output->GetRequestedRegion();
 
+        // allocate output
+        images.output->SetBufferedRegion(images.outputRegion);
+        images.output->Allocate();
+
+        if (m_AutomaticCropping) {
+            // the graph only covers the seed bounding box. everything else is background
+            images.inputRegion = ComputeSeedBoundingBox(images);
+            images.output->FillBuffer(m_BackgroundPixelValue);
+            if (!images.outputRegion.Crop(images.inputRegion)) { // nothing to query
+                typename InputImageType::SizeType empty;
+                empty.Fill(0);
+                images.outputRegion.SetSize(empty);
+            }
+            if (m_PrintTimer) {
+                std::cout << "Cropped graph to " << images.inputRegion << std::endl;
+            }
+        }
+
         // init ITK progress reporter
         // InitializeGraph() traverses the input image once
         int numberOfPixelDuringInit = images.inputRegion.GetNumberOfPixels();
@@ -52,10 +72,6 @@ namespace itk {
         // since both report to the same ProgressReporter, we add the total amount of pixels
         ProgressReporter progress(this, 0, numberOfPixelDuringInit + numberOfPixelDuringOutput);
 
-        // allocate output
-        images.output->SetBufferedRegion(images.outputRegion);
-        images.output->Allocate();
-
         // init samples and histogram
         typename SampleType::Pointer foregroundSample = SampleType::New();
         typename SampleType::Pointer backgroundSample = SampleType::New();
@@ -87,10 +103,10 @@ namespace itk {
     template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
     template<typename TIndexImage>
     std::vector<itk::Index<3> > ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
-    ::getPixelsLargerThanZero(const TIndexImage *const image) const{
+    ::getPixelsLargerThanZero(const TIndexImage *const image, typename TImage::RegionType region) const{
         std::vector<itk::Index<3> > pixelsWithValueLargerThanZero;
 
-        itk::ImageRegionConstIterator<TIndexImage> regionIterator(image, image->GetLargestPossibleRegion());
+        itk::ImageRegionConstIterator<TIndexImage> regionIterator(image, region);
         while (!regionIterator.IsAtEnd()) {
             if (regionIterator.Get() > itk::NumericTraits<typename TIndexImage::PixelType>::Zero) {
                 pixelsWithValueLargerThanZero.push_back(regionIterator.GetIndex());
@@ -105,8 +121,138 @@ namespace itk {
     unsigned int ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
     ::ConvertIndexToVertexDescriptor(const itk::Index<3> index, typename TImage::RegionType region) {
         typename TImage::SizeType size = region.GetSize();
+        typename TImage::IndexType start = region.GetIndex();
+
+        return (index[0] - start[0]) + (index[1] - start[1]) * size[0] + (index[2] - start[2]) * size[0] * size[1];
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    typename TImage::RegionType ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ComputeSeedBoundingBox(const ImageContainer &images) const {
+        typename TImage::RegionType largestRegion = images.input->GetLargestPossibleRegion();
+        itk::Index<3> min, max;
+        for (unsigned int i = 0; i < 3; ++i) {
+            min[i] = std::numeric_limits<itk::IndexValueType>::max();
+            max[i] = std::numeric_limits<itk::IndexValueType>::min();
+        }
+        ExpandBoundingBox(images.foreground.GetPointer(), min, max);
+        ExpandBoundingBox(images.background.GetPointer(), min, max);
+
+        if (min[0] > max[0]) { // no seeds at all
+            return largestRegion;
+        }
+
+        typename TImage::RegionType boundingBox;
+        for (unsigned int i = 0; i < 3; ++i) {
+            boundingBox.SetIndex(i, min[i] - static_cast<itk::IndexValueType>(m_CroppingMargin));
+            boundingBox.SetSize(i, max[i] - min[i] + 1 + 2 * m_CroppingMargin);
+        }
+        boundingBox.Crop(largestRegion);
+        return boundingBox;
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename TMaskImage>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ExpandBoundingBox(const TMaskImage *mask, itk::Index<3> &min, itk::Index<3> &max) const {
+        typename TMaskImage::RegionType region = mask->GetLargestPossibleRegion();
+        typename TMaskImage::SizeType size = region.GetSize();
+        typename TMaskImage::IndexType start = region.GetIndex();
+        const typename TMaskImage::PixelType *buffer = mask->GetBufferPointer() + mask->ComputeOffset(start);
+        const typename TMaskImage::SizeType bufferSize = mask->GetBufferedRegion().GetSize();
 
-        return index[0] + index[1] * size[0] + index[2] * size[0] * size[1];
+        std::vector<itk::Index<3> > threadMin(this->GetNumberOfThreads(), min);
+        std::vector<itk::Index<3> > threadMax(this->GetNumberOfThreads(), max);
+
+        ParallelFor(size[2], [&](unsigned int zBegin, unsigned int zEnd, unsigned int threadId) {
+            itk::Index<3> &localMin = threadMin[threadId];
+            itk::Index<3> &localMax = threadMax[threadId];
+            for (unsigned int z = zBegin; z < zEnd; ++z) {
+                for (unsigned int y = 0; y < size[1]; ++y) {
+                    const typename TMaskImage::PixelType *row = buffer + bufferSize[0] * (y + bufferSize[1] * z);
+                    // first and last seed of the row are enough to grow the box in x
+                    long first = -1, last = -1;
+                    for (unsigned int x = 0; x < size[0]; ++x) {
+                        if (row[x] > itk::NumericTraits<typename TMaskImage::PixelType>::Zero) {
+                            if (first < 0) {
+                                first = x;
+                            }
+                            last = x;
+                        }
+                    }
+                    if (first >= 0) {
+                        const itk::IndexValueType position[3] = {start[0] + first, start[1] + y, start[2] + z};
+                        localMin[0] = std::min(localMin[0], position[0]);
+                        localMax[0] = std::max(localMax[0], start[0] + last);
+                        for (unsigned int i = 1; i < 3; ++i) {
+                            localMin[i] = std::min(localMin[i], position[i]);
+                            localMax[i] = std::max(localMax[i], position[i]);
+                        }
+                    }
+                }
+            }
+        });
+
+        for (unsigned int t = 0; t < threadMin.size(); ++t) {
+            for (unsigned int i = 0; i < 3; ++i) {
+                min[i] = std::min(min[i], threadMin[t][i]);
+                max[i] = std::max(max[i], threadMax[t][i]);
+            }
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>::BoundaryDirectionType TDirection>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ComputeEdgeWeights(double centerPixel, double neighborPixel, double sigma, WeightType &forward, WeightType &backward) {
+        double difference = centerPixel - neighborPixel;
+        WeightType weight = exp(-(difference * difference) / (2.0 * sigma * sigma));
+        assert(weight >= 0);
+
+        // BrightDark: cutting from bright (source side) to dark is cheap. DarkBright the opposite
+        if (TDirection == BrightDark) {
+            forward = centerPixel > neighborPixel ? weight : 1.0f;
+            backward = centerPixel > neighborPixel ? 1.0f : weight;
+        } else if (TDirection == DarkBright) {
+            forward = centerPixel > neighborPixel ? 1.0f : weight;
+            backward = centerPixel > neighborPixel ? weight : 1.0f;
+        } else {
+            forward = weight;
+            backward = weight;
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>::BoundaryDirectionType TDirection>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ComputeEdgeWeights(const typename InputImageType::PixelType *center, const typename InputImageType::PixelType *neighbor,
+                         unsigned int n, double sigma, WeightType *forward, WeightType *backward) {
+        for (unsigned int i = 0; i < n; ++i) {
+            ComputeEdgeWeights<TDirection>(center[i], neighbor[i], sigma, forward[i], backward[i]);
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename TFunction>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ParallelFor(unsigned int n, TFunction f) const {
+        unsigned int numberOfChunks = std::max(1u, std::min<unsigned int>(this->GetNumberOfThreads(), n));
+        unsigned int chunkSize = (n + numberOfChunks - 1) / std::max(1u, numberOfChunks);
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < numberOfChunks; ++i) {
+            unsigned int begin = i * chunkSize;
+            unsigned int end = std::min(n, begin + chunkSize);
+            if (begin < end) {
+                threads.push_back(std::thread(f, begin, end, i));
+            }
+        }
+        // the calling thread works on the first chunk
+        f(0u, std::min(n, chunkSize), 0u);
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
     }
 }
 
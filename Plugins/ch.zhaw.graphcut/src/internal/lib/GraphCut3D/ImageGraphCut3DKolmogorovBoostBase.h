@@ -53,6 +53,10 @@ namespace itk{
     protected:
         ImageGraphCut3DKolmogorovBoostBase();
 
+        // adds the n-links of the 6-connected grid. instantiated once per boundary direction
+        template<typename SuperClass::BoundaryDirectionType TDirection>
+        void FillEdges(const ImageContainer &, ProgressReporter &progress);
+
         virtual ~ImageGraphCut3DKolmogorovBoostBase();
 
 	private:
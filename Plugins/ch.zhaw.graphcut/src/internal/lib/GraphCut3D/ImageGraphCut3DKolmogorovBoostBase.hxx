@@ -27,99 +27,98 @@ namespace itk{
 	void ImageGraphCut3DKolmogorovBoostBase<TImage, TForeground, TBackground, TOutput>
 	::FillGraph(const ImageContainer images, ProgressReporter &progress){
         InitializeGraph(images);
-        IndexContainerType sources = this->template getPixelsLargerThanZero<ForegroundImageType>(images.foreground);
-        IndexContainerType sinks = this->template getPixelsLargerThanZero<BackgroundImageType>(images.background);
+        IndexContainerType sources = this->template getPixelsLargerThanZero<ForegroundImageType>(images.foreground, images.inputRegion);
+        IndexContainerType sinks = this->template getPixelsLargerThanZero<BackgroundImageType>(images.background, images.inputRegion);
+
+        // the boundary direction is resolved once per run instead of once per edge
+        switch (this->m_BoundaryDirectionType) {
+            case SuperClass::BrightDark:
+                FillEdges<SuperClass::BrightDark>(images, progress);
+                break;
+            case SuperClass::DarkBright:
+                FillEdges<SuperClass::DarkBright>(images, progress);
+                break;
+            default:
+                FillEdges<SuperClass::NoDirection>(images, progress);
+                break;
+        }
+
+        // set the terminal connection capacity to max float
+        for (unsigned int i = 0; i < sources.size(); i++) {
+            unsigned int sourceIndex = this->ConvertIndexToVertexDescriptor(sources[i], images.inputRegion);
+            addTerminalEdges(sourceIndex, std::numeric_limits<float>::max(), 0);
+        }
+        for (unsigned int i = 0; i < sinks.size(); i++) {
+            unsigned int sinkIndex = this->ConvertIndexToVertexDescriptor(sinks[i], images.inputRegion);
+            addTerminalEdges(sinkIndex, 0, std::numeric_limits<float>::max());
+        }
+	};
 
-        // We are only using a 6-connected structure, so the kernel (iteration neighborhood) must only be 3x3x3
-        // (specified by a radius of 1)
-        itk::Size<3> radius;
-        radius.Fill(1);
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>::BoundaryDirectionType TDirection>
+    void ImageGraphCut3DKolmogorovBoostBase<TImage, TForeground, TBackground, TOutput>
+    ::FillEdges(const ImageContainer &images, ProgressReporter &progress){
+        typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        const unsigned int nx = size[0], ny = size[1], nz = size[2];
 
-        typedef itk::ConstShapedNeighborhoodIterator<InputImageType> IteratorType;
+        const typename InputImageType::PixelType *input = images.input->GetBufferPointer() + images.input->ComputeOffset(images.inputRegion.GetIndex());
+        const typename InputImageType::SizeType bufferSize = images.input->GetBufferedRegion().GetSize();
+        const size_t rowStride = bufferSize[0], sliceStride = bufferSize[0] * bufferSize[1];
 
-        // Traverses the image adding the following bidirectional edges:
+        // boundary terms of one row for the following bidirectional edges:
         // 1. currentPixel <-> pixel below it
         // 2. currentPixel <-> pixel to the right of it
         // 3. currentPixel <-> pixel in front of it
         // This prevents duplicate edges (i.e. we cannot add an edge to all 6-connected neighbors of every pixel or
         // almost every edge would be duplicated.
-        std::vector<typename IteratorType::OffsetType> neighbors;
-        typename IteratorType::OffsetType bottom = {{0, 1, 0}};
-        neighbors.push_back(bottom);
-        typename IteratorType::OffsetType right = {{1, 0, 0}};
-        neighbors.push_back(right);
-        typename IteratorType::OffsetType front = {{0, 0, 1}};
-        neighbors.push_back(front);
-
-        typename IteratorType::OffsetType center = {{0, 0, 0}};
-
-        IteratorType iterator(radius, images.input, images.input->GetLargestPossibleRegion());
-        iterator.ClearActiveList();
-        iterator.ActivateOffset(bottom);
-        iterator.ActivateOffset(right);
-        iterator.ActivateOffset(front);
-        iterator.ActivateOffset(center);
-
-        for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator) {
-            typename InputImageType::PixelType centerPixel = iterator.GetPixel(center);
-
-            for (unsigned int i = 0; i < neighbors.size(); i++) {
-                bool pixelIsValid;
-                typename InputImageType::PixelType neighborPixel  = iterator.GetPixel(neighbors[i], pixelIsValid);
-
-                // If the current neighbor is outside the image, skip it
-                if (!pixelIsValid) {
-                    continue;
+        std::vector<WeightType> bottomForward(nx), bottomBackward(nx);
+        std::vector<WeightType> rightForward(nx), rightBackward(nx);
+        std::vector<WeightType> frontForward(nx), frontBackward(nx);
+
+        for (unsigned int z = 0; z < nz; ++z) {
+            for (unsigned int y = 0; y < ny; ++y) {
+                const typename InputImageType::PixelType *row = input + y * rowStride + z * sliceStride;
+                const bool hasBottom = y + 1 < ny;
+                const bool hasFront = z + 1 < nz;
+
+                if (hasBottom) {
+                    this->template ComputeEdgeWeights<TDirection>(row, row + rowStride, nx, this->m_Sigma, bottomForward.data(), bottomBackward.data());
+                }
+                this->template ComputeEdgeWeights<TDirection>(row, row + 1, nx - 1, this->m_Sigma, rightForward.data(), rightBackward.data());
+                if (hasFront) {
+                    this->template ComputeEdgeWeights<TDirection>(row, row + sliceStride, nx, this->m_Sigma, frontForward.data(), frontBackward.data());
                 }
 
-                // Compute the edge weight
-                double weight = exp(-pow(centerPixel - neighborPixel, 2) / (2.0 * this->m_Sigma * this->m_Sigma));
-                assert(weight >= 0);
-
-                // Add the edge to the graph
-                unsigned int nodeIndex1 = this->ConvertIndexToVertexDescriptor(iterator.GetIndex(center), images.inputRegion);
-                unsigned int nodeIndex2 = this->ConvertIndexToVertexDescriptor(iterator.GetIndex(neighbors[i]), images.inputRegion);
-
-                //Determine which direction is used
-                if (this->m_BoundaryDirectionType == SuperClass::BrightDark) {
-                    if (centerPixel > neighborPixel)
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, weight, 1.0);
-                    else
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, 1.0, weight);
-                } else if (this->m_BoundaryDirectionType == SuperClass::DarkBright) {
-                    if (centerPixel > neighborPixel)
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, 1.0, weight);
-                    else
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, weight, 1.0);
-                } else {
-                    addBidirectionalEdge(nodeIndex1, nodeIndex2, weight, weight);
+                // Add the edges to the graph in the same order as a pixel wise traversal
+                unsigned int nodeIndex = nx * (y + ny * z);
+                for (unsigned int x = 0; x < nx; ++x, ++nodeIndex) {
+                    if (hasBottom) {
+                        addBidirectionalEdge(nodeIndex, nodeIndex + nx, bottomForward[x], bottomBackward[x]);
+                    }
+                    if (x + 1 < nx) {
+                        addBidirectionalEdge(nodeIndex, nodeIndex + 1, rightForward[x], rightBackward[x]);
+                    }
+                    if (hasFront) {
+                        addBidirectionalEdge(nodeIndex, nodeIndex + nx * ny, frontForward[x], frontBackward[x]);
+                    }
+                    progress.CompletedPixel();
                 }
             }
-            progress.CompletedPixel();
-        }
-
-        // set the terminal connection capacity to max float
-        for (unsigned int i = 0; i < sources.size(); i++) {
-            unsigned int sourceIndex = this->ConvertIndexToVertexDescriptor(sources[i], images.inputRegion);
-            addTerminalEdges(sourceIndex, std::numeric_limits<float>::max(), 0);
         }
-        for (unsigned int i = 0; i < sinks.size(); i++) {
-            unsigned int sinkIndex = this->ConvertIndexToVertexDescriptor(sinks[i], images.inputRegion);
-            addTerminalEdges(sinkIndex, 0, std::numeric_limits<float>::max());
-        }
-	};
+    }
 
 	template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
 	void ImageGraphCut3DKolmogorovBoostBase<TImage, TForeground, TBackground, TOutput>
 	::CutGraph(ImageContainer images, ProgressReporter &progress){
 
-        // Iterate over the output image, querying the graph for the association of each pixel
+        // Iterate over the output image, querying the graph for the association of each pixel. The vertices are numbered
+        // within the input region
         itk::ImageRegionIterator<OutputImageType> outputImageIterator(images.output, images.outputRegion);
         outputImageIterator.GoToBegin();
 
         int sourceGroup = groupOfSource();
         while (!outputImageIterator.IsAtEnd()) {
-            unsigned int voxelIndex = this->ConvertIndexToVertexDescriptor(outputImageIterator.GetIndex(), images.outputRegion);
+            unsigned int voxelIndex = this->ConvertIndexToVertexDescriptor(outputImageIterator.GetIndex(), images.inputRegion);
             if (groupOf(voxelIndex) == sourceGroup) {
                 outputImageIterator.Set(this->m_ForegroundPixelValue);
             }
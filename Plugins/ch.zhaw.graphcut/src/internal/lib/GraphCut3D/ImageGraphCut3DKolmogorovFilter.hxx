@@ -12,12 +12,71 @@
 
 #include "lib/kolmogorov-3.03/graph.h"
 #include "ImageGraphCut3DKolmogorovBoostBase.h"
+
+#include <limits>
 /*
  * Wraps kolmogorovs graph library
  */
 namespace itk{
+    /*!
+     * Capacity representation of the Kolmogorov graph.
+     *
+     * float: the weights are used as they are.
+     * int / short: the weights (0..1) are scaled and rounded to integers. Integer flow arithmetic is exact, so results
+     * do not drift between runs, and short arcs halve the size of the arc array. The hard terminal links exceed the
+     * summed capacity of the 6 n-links of a vertex, which is enough to pin a seed to its terminal. The total flow is
+     * accumulated in 64 bit.
+     */
+    template<typename TCapacity>
+    struct KolmogorovCapacityTraits;
+
+    template<>
+    struct KolmogorovCapacityTraits<float> {
+        typedef Graph<float, float, float> GraphType;
+        typedef float TerminalCapacityType;
+
+        static inline float Quantize(float weight) {
+            return weight;
+        }
+
+        static inline float HardLink() {
+            return std::numeric_limits<float>::max();
+        }
+    };
+
+    template<>
+    struct KolmogorovCapacityTraits<int> {
+        typedef Graph<int, int, long long> GraphType;
+        typedef int TerminalCapacityType;
+        static const int Scale = 1 << 16;
+
+        static inline int Quantize(float weight) {
+            return static_cast<int>(weight * Scale + 0.5f);
+        }
+
+        static inline int HardLink() {
+            return 6 * Scale + 1;
+        }
+    };
+
+    template<>
+    struct KolmogorovCapacityTraits<short> {
+        // residual capacities of an arc pair add up to 2 * Scale, which has to fit into a short
+        typedef Graph<short, int, long long> GraphType;
+        typedef int TerminalCapacityType;
+        static const int Scale = 1 << 13;
+
+        static inline short Quantize(float weight) {
+            return static_cast<short>(weight * Scale + 0.5f);
+        }
+
+        static inline int HardLink() {
+            return 6 * Scale + 1;
+        }
+    };
+
     //! GraphCut solver using Yuri Boykov and Vladimir Kolmogorovs MAXFLOW implementation
-	template<typename TInput, typename TForeground, typename TBackground, typename TOutput>
+	template<typename TInput, typename TForeground, typename TBackground, typename TOutput, typename TCapacity = float>
 	class ImageGraphCut3DKolmogorovFilter : public ImageGraphCut3DKolmogorovBoostBase<TInput, TForeground, TBackground, TOutput>{
 	public:
 		// ITK related defaults
@@ -38,18 +97,19 @@ namespace itk{
         typedef typename SuperClass::WeightType WeightType;
 
         typedef typename SuperClass::ImageContainer ImageContainer;
-		typedef Graph<WeightType , WeightType , WeightType> GraphType;
+        typedef KolmogorovCapacityTraits<TCapacity> CapacityTraits;
+		typedef typename CapacityTraits::GraphType GraphType;
 
-        virtual void InitializeGraph(const ImageContainer) override
+        virtual void InitializeGraph(const ImageContainer images) override
         {
-            typename InputImageType::SizeType dimensions;
-            dimensions = this->GetInputImage()->GetLargestPossibleRegion().GetSize();
+            typename InputImageType::SizeType dimensions = images.inputRegion.GetSize();
 
             int numberOfVertices = dimensions[0] * dimensions[1] * dimensions[2];
             int numberOfEdges = calculateNumberOfEdges(dimensions[0], dimensions[1], dimensions[2]);
 
             std::cout << "Number of vertices: " << numberOfVertices << ", number of edges: " << numberOfEdges << std::endl;
 
+            delete m_Graph;
             m_Graph = new GraphType(numberOfVertices, numberOfEdges);
             m_Graph->add_node(numberOfVertices);
         }
@@ -57,11 +117,11 @@ namespace itk{
 
         // boykov_kolmogorov_max_flow requires all edges to have a reverse edge.
         virtual inline void addBidirectionalEdge(const unsigned int source, const unsigned int target, const float weight, const float reverseWeight) override {
-            m_Graph->add_edge(source, target, weight, reverseWeight);
+            m_Graph->add_edge(source, target, CapacityTraits::Quantize(weight), CapacityTraits::Quantize(reverseWeight));
         }
 
         virtual inline void addTerminalEdges(const unsigned int node, const float sourceWeight, const float sinkWeight) override{
-            m_Graph->add_tweights(node, sourceWeight, sinkWeight);
+            m_Graph->add_tweights(node, quantizeTerminalWeight(sourceWeight), quantizeTerminalWeight(sinkWeight));
         }
 
         // start the calculation
@@ -100,6 +160,11 @@ namespace itk{
         }
 
 	protected:
+        // the base class marks hard links with max float
+        static inline typename CapacityTraits::TerminalCapacityType quantizeTerminalWeight(const float weight) {
+            return weight >= std::numeric_limits<float>::max() ? CapacityTraits::HardLink() : CapacityTraits::Quantize(weight);
+        }
+
         ImageGraphCut3DKolmogorovFilter(){
            m_Graph = new GraphType(1,1);
         };
@@ -0,0 +1,433 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+#ifndef __ImageGraphCut3DSupervoxelFilter_hxx_
+#define __ImageGraphCut3DSupervoxelFilter_hxx_
+
+#include "ImageGraphCut3DSupervoxelFilter.h"
+
+namespace itk {
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::ImageGraphCut3DSupervoxelFilter()
+            : m_NumberOfSupervoxels(0),
+              m_Graph(nullptr),
+              m_BandGraph(nullptr),
+              m_SupervoxelSize(8),
+              m_Compactness(50.0),
+              m_NumberOfSupervoxelIterations(5),
+              m_RefinementBandWidth(2) {
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::~ImageGraphCut3DSupervoxelFilter() {
+        delete m_Graph;
+        delete m_BandGraph;
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::ComputeSupervoxels(const ImageContainer &images) {
+        typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        const unsigned int nx = size[0], ny = size[1], nz = size[2];
+        const unsigned int S = m_SupervoxelSize;
+        const unsigned int gx = (nx + S - 1) / S, gy = (ny + S - 1) / S, gz = (nz + S - 1) / S;
+
+        const typename InputImageType::PixelType *input = images.input->GetBufferPointer() + images.input->ComputeOffset(images.inputRegion.GetIndex());
+        const typename InputImageType::SizeType bufferSize = images.input->GetBufferedRegion().GetSize();
+        auto inputAt = [&](unsigned int x, unsigned int y, unsigned int z) {
+            return static_cast<double>(input[x + bufferSize[0] * (y + bufferSize[1] * z)]);
+        };
+
+        // seed the supervoxels on a regular grid, one per S^3 cell
+        m_NumberOfSupervoxels = gx * gy * gz;
+        std::vector<Center> centers(m_NumberOfSupervoxels);
+        for (unsigned int cz = 0; cz < gz; ++cz) {
+            for (unsigned int cy = 0; cy < gy; ++cy) {
+                for (unsigned int cx = 0; cx < gx; ++cx) {
+                    Center &c = centers[cx + gx * (cy + gy * cz)];
+                    c.x = cx * S + (std::min(S, nx - cx * S) - 1) / 2.0;
+                    c.y = cy * S + (std::min(S, ny - cy * S) - 1) / 2.0;
+                    c.z = cz * S + (std::min(S, nz - cz * S) - 1) / 2.0;
+                    c.intensity = inputAt(static_cast<unsigned int>(c.x), static_cast<unsigned int>(c.y), static_cast<unsigned int>(c.z));
+                }
+            }
+        }
+
+        m_Labels.assign(static_cast<size_t>(nx) * ny * nz, 0);
+        const double spatialWeight = (m_Compactness / S) * (m_Compactness / S);
+        const unsigned int numberOfThreads = std::max(1u, static_cast<unsigned int>(this->GetNumberOfThreads()));
+
+        // SLIC: every voxel is assigned to the closest of the centers seeded in its own and the 26 adjacent grid cells.
+        // the centers are then moved to the mean of their assigned voxels.
+        for (unsigned int iteration = 0; iteration < std::max(1u, m_NumberOfSupervoxelIterations); ++iteration) {
+            // x, y, z, intensity, count per supervoxel and thread
+            std::vector<std::vector<double> > sums(numberOfThreads, std::vector<double>(5 * m_NumberOfSupervoxels, 0.0));
+
+            this->ParallelFor(nz, [&](unsigned int zBegin, unsigned int zEnd, unsigned int threadId) {
+                std::vector<double> &sum = sums[threadId];
+                for (unsigned int z = zBegin; z < zEnd; ++z) {
+                    const int cz = z / S;
+                    for (unsigned int y = 0; y < ny; ++y) {
+                        const int cy = y / S;
+                        for (unsigned int x = 0; x < nx; ++x) {
+                            const int cx = x / S;
+                            const double intensity = inputAt(x, y, z);
+
+                            double bestDistance = std::numeric_limits<double>::max();
+                            LabelType bestLabel = 0;
+                            for (int dz = std::max(0, cz - 1); dz <= std::min<int>(gz - 1, cz + 1); ++dz) {
+                                for (int dy = std::max(0, cy - 1); dy <= std::min<int>(gy - 1, cy + 1); ++dy) {
+                                    for (int dx = std::max(0, cx - 1); dx <= std::min<int>(gx - 1, cx + 1); ++dx) {
+                                        const LabelType label = dx + gx * (dy + gy * dz);
+                                        const Center &c = centers[label];
+                                        const double spatial = (x - c.x) * (x - c.x) + (y - c.y) * (y - c.y) + (z - c.z) * (z - c.z);
+                                        const double distance = (intensity - c.intensity) * (intensity - c.intensity) + spatialWeight * spatial;
+                                        if (distance < bestDistance) {
+                                            bestDistance = distance;
+                                            bestLabel = label;
+                                        }
+                                    }
+                                }
+                            }
+
+                            m_Labels[x + nx * (y + static_cast<size_t>(ny) * z)] = bestLabel;
+                            double *s = &sum[5 * bestLabel];
+                            s[0] += x;
+                            s[1] += y;
+                            s[2] += z;
+                            s[3] += intensity;
+                            s[4] += 1;
+                        }
+                    }
+                }
+            });
+
+            for (unsigned int label = 0; label < m_NumberOfSupervoxels; ++label) {
+                double s[5] = {0, 0, 0, 0, 0};
+                for (unsigned int t = 0; t < numberOfThreads; ++t) {
+                    for (unsigned int k = 0; k < 5; ++k) {
+                        s[k] += sums[t][5 * label + k];
+                    }
+                }
+                if (s[4] > 0) { // supervoxels can vanish. their center stays where it is
+                    centers[label].x = s[0] / s[4];
+                    centers[label].y = s[1] / s[4];
+                    centers[label].z = s[2] / s[4];
+                    centers[label].intensity = s[3] / s[4];
+                }
+            }
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>::BoundaryDirectionType TDirection>
+    void ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::FillFaceEdges(const ImageContainer &images, std::vector<EdgeMapType> &edges, std::vector<std::vector<unsigned char> > &seedFlags) const {
+        typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        const unsigned int nx = size[0], ny = size[1], nz = size[2];
+
+        const typename InputImageType::PixelType *input = images.input->GetBufferPointer() + images.input->ComputeOffset(images.inputRegion.GetIndex());
+        const typename ForegroundImageType::PixelType *foreground = images.foreground->GetBufferPointer() + images.foreground->ComputeOffset(images.inputRegion.GetIndex());
+        const typename BackgroundImageType::PixelType *background = images.background->GetBufferPointer() + images.background->ComputeOffset(images.inputRegion.GetIndex());
+        const typename InputImageType::SizeType bufferSize = images.input->GetBufferedRegion().GetSize();
+        const typename ForegroundImageType::SizeType foregroundBufferSize = images.foreground->GetBufferedRegion().GetSize();
+        const typename BackgroundImageType::SizeType backgroundBufferSize = images.background->GetBufferedRegion().GetSize();
+
+        this->ParallelFor(nz, [&](unsigned int zBegin, unsigned int zEnd, unsigned int threadId) {
+            EdgeMapType &edgeMap = edges[threadId];
+            std::vector<unsigned char> &flags = seedFlags[threadId];
+            for (unsigned int z = zBegin; z < zEnd; ++z) {
+                for (unsigned int y = 0; y < ny; ++y) {
+                    for (unsigned int x = 0; x < nx; ++x) {
+                        const size_t v = x + nx * (y + static_cast<size_t>(ny) * z);
+                        const LabelType a = m_Labels[v];
+                        const double centerPixel = input[x + bufferSize[0] * (y + bufferSize[1] * z)];
+
+                        if (foreground[x + foregroundBufferSize[0] * (y + foregroundBufferSize[1] * z)] > itk::NumericTraits<typename ForegroundImageType::PixelType>::Zero) {
+                            flags[a] |= 1;
+                        }
+                        if (background[x + backgroundBufferSize[0] * (y + backgroundBufferSize[1] * z)] > itk::NumericTraits<typename BackgroundImageType::PixelType>::Zero) {
+                            flags[a] |= 2;
+                        }
+
+                        // right, bottom, front. prevents duplicate edges
+                        const unsigned int neighbors[3][3] = {{x + 1, y, z}, {x, y + 1, z}, {x, y, z + 1}};
+                        for (unsigned int i = 0; i < 3; ++i) {
+                            const unsigned int qx = neighbors[i][0], qy = neighbors[i][1], qz = neighbors[i][2];
+                            if (qx >= nx || qy >= ny || qz >= nz) {
+                                continue;
+                            }
+                            const LabelType b = m_Labels[qx + nx * (qy + static_cast<size_t>(ny) * qz)];
+                            if (a == b) {
+                                continue;
+                            }
+
+                            WeightType forward, backward;
+                            SuperClass::template ComputeEdgeWeights<TDirection>(centerPixel, input[qx + bufferSize[0] * (qy + bufferSize[1] * qz)], this->m_Sigma, forward, backward);
+                            if (a < b) {
+                                std::pair<WeightType, WeightType> &capacity = edgeMap[(static_cast<unsigned long long>(a) << 32) | b];
+                                capacity.first += forward;
+                                capacity.second += backward;
+                            } else {
+                                std::pair<WeightType, WeightType> &capacity = edgeMap[(static_cast<unsigned long long>(b) << 32) | a];
+                                capacity.first += backward;
+                                capacity.second += forward;
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::FillGraph(const ImageContainer images, ProgressReporter &progress) {
+        m_Images = images;
+        ComputeSupervoxels(images);
+
+        // accumulate the voxel level boundary weights along the faces shared by 2 supervoxels.
+        // bit 0 of the seed flags marks supervoxels containing foreground seeds, bit 1 background seeds.
+        const unsigned int numberOfThreads = std::max(1u, static_cast<unsigned int>(this->GetNumberOfThreads()));
+        std::vector<EdgeMapType> edges(numberOfThreads);
+        std::vector<std::vector<unsigned char> > seedFlags(numberOfThreads, std::vector<unsigned char>(m_NumberOfSupervoxels, 0));
+
+        // the boundary direction is resolved once per run instead of once per edge
+        switch (this->m_BoundaryDirectionType) {
+            case SuperClass::BrightDark:
+                FillFaceEdges<SuperClass::BrightDark>(images, edges, seedFlags);
+                break;
+            case SuperClass::DarkBright:
+                FillFaceEdges<SuperClass::DarkBright>(images, edges, seedFlags);
+                break;
+            default:
+                FillFaceEdges<SuperClass::NoDirection>(images, edges, seedFlags);
+                break;
+        }
+
+        // merge the per thread results
+        for (unsigned int t = 1; t < numberOfThreads; ++t) {
+            for (const auto &edge : edges[t]) {
+                std::pair<WeightType, WeightType> &capacity = edges[0][edge.first];
+                capacity.first += edge.second.first;
+                capacity.second += edge.second.second;
+            }
+            edges[t].clear();
+            for (unsigned int label = 0; label < m_NumberOfSupervoxels; ++label) {
+                seedFlags[0][label] |= seedFlags[t][label];
+            }
+        }
+        for (unsigned int i = 0, max = images.inputRegion.GetNumberOfPixels(); i < max; ++i) {
+            progress.CompletedPixel();
+        }
+
+        std::cout << "Number of supervoxels: " << m_NumberOfSupervoxels << ", number of edges: " << edges[0].size() << std::endl;
+
+        delete m_Graph;
+        m_Graph = new GraphType(m_NumberOfSupervoxels, edges[0].size());
+        m_Graph->add_node(m_NumberOfSupervoxels);
+        for (const auto &edge : edges[0]) {
+            m_Graph->add_edge(static_cast<LabelType>(edge.first >> 32), static_cast<LabelType>(edge.first & 0xffffffff), edge.second.first, edge.second.second);
+        }
+
+        // supervoxels containing both foreground and background seeds stay unconstrained. the band refinement resolves
+        // them on voxel level.
+        for (unsigned int label = 0; label < m_NumberOfSupervoxels; ++label) {
+            if (seedFlags[0][label] == 1) {
+                m_Graph->add_tweights(label, std::numeric_limits<float>::max(), 0);
+            } else if (seedFlags[0][label] == 2) {
+                m_Graph->add_tweights(label, 0, std::numeric_limits<float>::max());
+            }
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::SolveGraph() {
+        m_Graph->maxflow();
+        if (m_RefinementBandWidth > 0) {
+            RefineBand();
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::RefineBand() {
+        const ImageContainer &images = m_Images;
+        typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        const unsigned int nx = size[0], ny = size[1], nz = size[2];
+        const size_t numberOfVoxels = static_cast<size_t>(nx) * ny * nz;
+        const int w = m_RefinementBandWidth;
+
+        std::vector<unsigned char> supervoxelIsSource(m_NumberOfSupervoxels);
+        for (unsigned int label = 0; label < m_NumberOfSupervoxels; ++label) {
+            supervoxelIsSource[label] = m_Graph->what_segment(label) == GraphType::SOURCE;
+        }
+        auto isSource = [&](size_t v) { return supervoxelIsSource[m_Labels[v]]; };
+
+        // mark voxels whose 6-neighborhood contains the supervoxel cut
+        std::vector<unsigned char> band(numberOfVoxels, 0);
+        this->ParallelFor(nz, [&](unsigned int zBegin, unsigned int zEnd, unsigned int) {
+            for (unsigned int z = zBegin; z < zEnd; ++z) {
+                for (unsigned int y = 0; y < ny; ++y) {
+                    for (unsigned int x = 0; x < nx; ++x) {
+                        const size_t v = x + nx * (y + static_cast<size_t>(ny) * z);
+                        const unsigned char s = isSource(v);
+                        band[v] = (x > 0 && isSource(v - 1) != s) || (x + 1 < nx && isSource(v + 1) != s)
+                                  || (y > 0 && isSource(v - nx) != s) || (y + 1 < ny && isSource(v + nx) != s)
+                                  || (z > 0 && isSource(v - nx * ny) != s) || (z + 1 < nz && isSource(v + static_cast<size_t>(nx) * ny) != s);
+                    }
+                }
+            }
+        });
+
+        // widen the band with a separable (2w+1)^3 box dilation
+        const size_t strides[3] = {1, nx, static_cast<size_t>(nx) * ny};
+        const unsigned int lengths[3] = {nx, ny, nz};
+        for (unsigned int axis = 0; axis < 3; ++axis) {
+            std::vector<unsigned char> dilated(numberOfVoxels, 0);
+            const size_t stride = strides[axis];
+            const int length = lengths[axis];
+            this->ParallelFor(nz, [&](unsigned int zBegin, unsigned int zEnd, unsigned int) {
+                for (unsigned int z = zBegin; z < zEnd; ++z) {
+                    for (unsigned int y = 0; y < ny; ++y) {
+                        for (unsigned int x = 0; x < nx; ++x) {
+                            const unsigned int position[3] = {x, y, z};
+                            const int p = position[axis];
+                            const size_t v = x + nx * (y + static_cast<size_t>(ny) * z);
+                            for (int d = std::max(-w, -p); d <= std::min(w, length - 1 - p) && !dilated[v]; ++d) {
+                                dilated[v] = band[v + d * static_cast<std::ptrdiff_t>(stride)];
+                            }
+                        }
+                    }
+                }
+            });
+            band.swap(dilated);
+        }
+
+        // number the band voxels
+        m_BandNode.assign(numberOfVoxels, -1);
+        int numberOfBandVoxels = 0;
+        for (size_t v = 0; v < numberOfVoxels; ++v) {
+            if (band[v]) {
+                m_BandNode[v] = numberOfBandVoxels++;
+            }
+        }
+        std::cout << "Refining " << numberOfBandVoxels << " voxels along the supervoxel cut" << std::endl;
+
+        delete m_BandGraph;
+        m_BandGraph = new GraphType(numberOfBandVoxels, 3 * numberOfBandVoxels);
+        m_BandGraph->add_node(numberOfBandVoxels);
+
+        switch (this->m_BoundaryDirectionType) {
+            case SuperClass::BrightDark:
+                FillBandEdges<SuperClass::BrightDark>(supervoxelIsSource);
+                break;
+            case SuperClass::DarkBright:
+                FillBandEdges<SuperClass::DarkBright>(supervoxelIsSource);
+                break;
+            default:
+                FillBandEdges<SuperClass::NoDirection>(supervoxelIsSource);
+                break;
+        }
+
+        m_BandGraph->maxflow();
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>::BoundaryDirectionType TDirection>
+    void ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::FillBandEdges(const std::vector<unsigned char> &supervoxelIsSource) {
+        const ImageContainer &images = m_Images;
+        typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        const unsigned int nx = size[0], ny = size[1], nz = size[2];
+
+        const typename InputImageType::PixelType *input = images.input->GetBufferPointer() + images.input->ComputeOffset(images.inputRegion.GetIndex());
+        const typename ForegroundImageType::PixelType *foreground = images.foreground->GetBufferPointer() + images.foreground->ComputeOffset(images.inputRegion.GetIndex());
+        const typename BackgroundImageType::PixelType *background = images.background->GetBufferPointer() + images.background->ComputeOffset(images.inputRegion.GetIndex());
+        const typename InputImageType::SizeType bufferSize = images.input->GetBufferedRegion().GetSize();
+        const typename ForegroundImageType::SizeType foregroundBufferSize = images.foreground->GetBufferedRegion().GetSize();
+        const typename BackgroundImageType::SizeType backgroundBufferSize = images.background->GetBufferedRegion().GetSize();
+        auto isSource = [&](size_t v) { return supervoxelIsSource[m_Labels[v]]; };
+
+        // voxel level graph. neighbors outside of the band are fixed to their supervoxels terminal, so the edge to them
+        // becomes a terminal edge.
+        for (unsigned int z = 0; z < nz; ++z) {
+            for (unsigned int y = 0; y < ny; ++y) {
+                for (unsigned int x = 0; x < nx; ++x) {
+                    const size_t v = x + nx * (y + static_cast<size_t>(ny) * z);
+                    const int node = m_BandNode[v];
+                    if (node < 0) {
+                        continue;
+                    }
+
+                    if (foreground[x + foregroundBufferSize[0] * (y + foregroundBufferSize[1] * z)] > itk::NumericTraits<typename ForegroundImageType::PixelType>::Zero) {
+                        m_BandGraph->add_tweights(node, std::numeric_limits<float>::max(), 0);
+                    }
+                    if (background[x + backgroundBufferSize[0] * (y + backgroundBufferSize[1] * z)] > itk::NumericTraits<typename BackgroundImageType::PixelType>::Zero) {
+                        m_BandGraph->add_tweights(node, 0, std::numeric_limits<float>::max());
+                    }
+
+                    const double centerPixel = input[x + bufferSize[0] * (y + bufferSize[1] * z)];
+                    const int neighbors[6][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {-1, 0, 0}, {0, -1, 0}, {0, 0, -1}};
+                    for (unsigned int i = 0; i < 6; ++i) {
+                        const int qx = x + neighbors[i][0], qy = y + neighbors[i][1], qz = z + neighbors[i][2];
+                        if (qx < 0 || qy < 0 || qz < 0 || qx >= static_cast<int>(nx) || qy >= static_cast<int>(ny) || qz >= static_cast<int>(nz)) {
+                            continue;
+                        }
+                        const size_t q = qx + nx * (qy + static_cast<size_t>(ny) * qz);
+
+                        WeightType forward, backward;
+                        SuperClass::template ComputeEdgeWeights<TDirection>(centerPixel, input[qx + bufferSize[0] * (qy + bufferSize[1] * qz)], this->m_Sigma, forward, backward);
+                        if (m_BandNode[q] >= 0) {
+                            if (i < 3) { // both inside the band, add every edge once
+                                m_BandGraph->add_edge(node, m_BandNode[q], forward, backward);
+                            }
+                        } else if (isSource(q)) {
+                            m_BandGraph->add_tweights(node, backward, 0);
+                        } else {
+                            m_BandGraph->add_tweights(node, 0, forward);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput>
+    ::CutGraph(ImageContainer images, ProgressReporter &progress) {
+        std::vector<unsigned char> supervoxelIsSource(m_NumberOfSupervoxels);
+        for (unsigned int label = 0; label < m_NumberOfSupervoxels; ++label) {
+            supervoxelIsSource[label] = m_Graph->what_segment(label) == GraphType::SOURCE;
+        }
+        const bool refined = m_RefinementBandWidth > 0 && m_BandGraph != nullptr;
+
+        // Iterate over the output image, querying the graph for the association of each pixel
+        itk::ImageRegionIterator<OutputImageType> outputImageIterator(images.output, images.outputRegion);
+        outputImageIterator.GoToBegin();
+
+        while (!outputImageIterator.IsAtEnd()) {
+            unsigned int voxelIndex = this->ConvertIndexToVertexDescriptor(outputImageIterator.GetIndex(), images.inputRegion);
+            bool isForeground;
+            if (refined && m_BandNode[voxelIndex] >= 0) {
+                isForeground = m_BandGraph->what_segment(m_BandNode[voxelIndex]) == GraphType::SOURCE;
+            } else {
+                isForeground = supervoxelIsSource[m_Labels[voxelIndex]] != 0;
+            }
+            outputImageIterator.Set(isForeground ? this->m_ForegroundPixelValue : this->m_BackgroundPixelValue);
+            ++outputImageIterator;
+            progress.CompletedPixel();
+        }
+    }
+}
+
+#endif // __ImageGraphCut3DSupervoxelFilter_hxx_
@@ -74,6 +74,10 @@ protected:
 	ImageGridCutFilter();
     virtual ~ImageGridCutFilter();
 
+    // fills the 6 neighbor capacities of the 6-connected grid. instantiated once per boundary direction
+    template<typename SuperClass::BoundaryDirectionType TDirection>
+    void FillCapacities(const ImageContainer &, CapacityType &capacities);
+
     GraphType* m_Graph;
 
 private:
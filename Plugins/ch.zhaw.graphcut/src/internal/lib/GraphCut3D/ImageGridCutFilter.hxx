@@ -27,105 +27,32 @@ namespace itk {
     template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
     void ImageGridCutFilter <TImage, TForeground, TBackground, TOutput>
     ::FillGraph(const ImageContainer images, ProgressReporter &progress){
-        typename InputImageType::SizeType dimensions;
-        dimensions = this->GetInputImage()->GetLargestPossibleRegion().GetSize();
+        typename InputImageType::SizeType dimensions = images.inputRegion.GetSize();
+        delete m_Graph;
         m_Graph = new GraphType(dimensions[0],dimensions[1],dimensions[2], this->GetNumberOfThreads(), 100);
 
-        // We are only using a 6-connected structure, so the kernel (iteration neighborhood) must only be 3x3x3
-        // (specified by a radius of 1)
-        itk::Size<3> radius;
-        radius.Fill(1);
-
-        typedef itk::ConstShapedNeighborhoodIterator<InputImageType> IteratorType;
-
-        // Traverses the image adding the following bidirectional edges:
-        // 1. currentPixel <-> pixel below it
-        // 2. currentPixel <-> pixel to the right of it
-        // 3. currentPixel <-> pixel in front of it
-        // This prevents duplicate edges (i.e. we cannot add an edge to all 6-connected neighbors of every pixel or
-        // almost every edge would be duplicated.
-        std::vector<typename IteratorType::OffsetType> neighbors;
-
-        typename IteratorType::OffsetType left = {{-1, 0, 0}};
-        neighbors.push_back(left);
-        typename IteratorType::OffsetType right = {{1, 0, 0}};
-        neighbors.push_back(right);
-        typename IteratorType::OffsetType top = {{0, -1, 0}};
-        neighbors.push_back(top);
-        typename IteratorType::OffsetType bottom = {{0, 1, 0}};
-        neighbors.push_back(bottom);
-        typename IteratorType::OffsetType back = {{0, 0, -1}};
-        neighbors.push_back(back);
-        typename IteratorType::OffsetType front = {{0, 0, 1}};
-        neighbors.push_back(front);
-
-        typename IteratorType::OffsetType center = {{0, 0, 0}};
-
-        IteratorType iterator(radius, images.input, images.input->GetLargestPossibleRegion());
-        iterator.ClearActiveList();
-        iterator.ActivateOffset(bottom);
-        iterator.ActivateOffset(right);
-        iterator.ActivateOffset(front);
-        iterator.ActivateOffset(center);
-
-
-
-        typename InputImageType::SizeType graphSize = images.input->GetLargestPossibleRegion().GetSize();
         unsigned int nGraphNodes(1);
-
         for (int iSize = 0; iSize < 3; ++iSize) {
-            nGraphNodes *= graphSize[iSize];
+            nGraphNodes *= dimensions[iSize];
         }
 
-        CapacityType capacities(neighbors.size() + 2, std::vector<WeightType>(nGraphNodes, 0));
-        unsigned int iVoxel(0);
-        for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator, ++iVoxel) {
-            typename InputImageType::PixelType centerPixel = iterator.GetPixel(center);
-            // Add the edge to the graph
-            itk::Index<3> currentNodeIndex = iterator.GetIndex(center);
-
-            // Fill the source
-            if (images.foreground->GetPixel(currentNodeIndex) > itk::NumericTraits<typename ForegroundImageType::PixelType>::Zero)
-                capacities[0][iVoxel] =  std::numeric_limits<float>::max();
-            if (images.background->GetPixel(currentNodeIndex) > itk::NumericTraits<typename BackgroundImageType::PixelType>::Zero)
-                capacities[1][iVoxel] =  std::numeric_limits<float>::max();
-
-            for (unsigned int i = 0; i < neighbors.size(); i++) {
-                bool pixelIsValid;
-                typename InputImageType::PixelType neighborPixel  = iterator.GetPixel(neighbors[i], pixelIsValid);
-
-                // If the current neighbor is outside the image, skip it
-                if (!pixelIsValid) {
-                    continue;
-                }
-
-                // Compute the edge weight
-                double weight = exp(-pow(centerPixel - neighborPixel, 2) / (2.0 * this->m_Sigma * this->m_Sigma));
-                assert(weight >= 0);
-
-
-                //Determine which direction is used
-                switch (this->m_BoundaryDirectionType)
-                {
-                    case SuperClass::BrightDark:{
-                        if (centerPixel > neighborPixel)
-                            capacities[i + 2][iVoxel] = weight;
-                        else
-                            capacities[i + 2][iVoxel] = 1.0;
-                    }
-
-                    case SuperClass::DarkBright:{
-                        if (centerPixel > neighborPixel)
-                            capacities[i + 2][iVoxel] = 1.0;
-                        else
-                            capacities[i + 2][iVoxel] = weight;
-                    }
-
-                    default:
-                        capacities[i + 2][iVoxel] = weight;
-                }
-
-            }
+        // source, sink and one capacity per neighbor (left, right, top, bottom, back, front) in the order expected by
+        // GridGraph_3D_6C_MT::set_caps
+        CapacityType capacities(8, std::vector<WeightType>(nGraphNodes, 0));
+
+        // the boundary direction is resolved once per run instead of once per edge
+        switch (this->m_BoundaryDirectionType) {
+            case SuperClass::BrightDark:
+                FillCapacities<SuperClass::BrightDark>(images, capacities);
+                break;
+            case SuperClass::DarkBright:
+                FillCapacities<SuperClass::DarkBright>(images, capacities);
+                break;
+            default:
+                FillCapacities<SuperClass::NoDirection>(images, capacities);
+                break;
+        }
+        for (unsigned int i = 0; i < nGraphNodes; ++i) {
             progress.CompletedPixel();
         }
 
@@ -139,6 +66,59 @@ namespace itk {
                              capacities[7].data());
     }
 
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>::BoundaryDirectionType TDirection>
+    void ImageGridCutFilter <TImage, TForeground, TBackground, TOutput>
+    ::FillCapacities(const ImageContainer &images, CapacityType &capacities){
+        typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        const unsigned int nx = size[0], ny = size[1], nz = size[2];
+
+        const typename InputImageType::PixelType *input = images.input->GetBufferPointer() + images.input->ComputeOffset(images.inputRegion.GetIndex());
+        const typename ForegroundImageType::PixelType *foreground = images.foreground->GetBufferPointer() + images.foreground->ComputeOffset(images.inputRegion.GetIndex());
+        const typename BackgroundImageType::PixelType *background = images.background->GetBufferPointer() + images.background->ComputeOffset(images.inputRegion.GetIndex());
+        const typename InputImageType::SizeType bufferSize = images.input->GetBufferedRegion().GetSize();
+        const typename ForegroundImageType::SizeType foregroundBufferSize = images.foreground->GetBufferedRegion().GetSize();
+        const typename BackgroundImageType::SizeType backgroundBufferSize = images.background->GetBufferedRegion().GetSize();
+        const size_t rowStride = bufferSize[0], sliceStride = bufferSize[0] * bufferSize[1];
+
+        // every row writes to its own part of the capacity arrays
+        this->ParallelFor(nz, [&](unsigned int zBegin, unsigned int zEnd, unsigned int) {
+            std::vector<WeightType> backward(nx); // capacities towards the center are set by the neighbor itself
+            for (unsigned int z = zBegin; z < zEnd; ++z) {
+                for (unsigned int y = 0; y < ny; ++y) {
+                    const typename InputImageType::PixelType *row = input + y * rowStride + z * sliceStride;
+                    const unsigned int v = nx * (y + ny * z);
+
+                    // terminals
+                    const typename ForegroundImageType::PixelType *foregroundRow = foreground + foregroundBufferSize[0] * (y + foregroundBufferSize[1] * z);
+                    const typename BackgroundImageType::PixelType *backgroundRow = background + backgroundBufferSize[0] * (y + backgroundBufferSize[1] * z);
+                    for (unsigned int x = 0; x < nx; ++x) {
+                        if (foregroundRow[x] > itk::NumericTraits<typename ForegroundImageType::PixelType>::Zero)
+                            capacities[0][v + x] = std::numeric_limits<float>::max();
+                        if (backgroundRow[x] > itk::NumericTraits<typename BackgroundImageType::PixelType>::Zero)
+                            capacities[1][v + x] = std::numeric_limits<float>::max();
+                    }
+
+                    // left, right
+                    if (nx > 1) {
+                        this->template ComputeEdgeWeights<TDirection>(row + 1, row, nx - 1, this->m_Sigma, &capacities[2][v + 1], backward.data());
+                        this->template ComputeEdgeWeights<TDirection>(row, row + 1, nx - 1, this->m_Sigma, &capacities[3][v], backward.data());
+                    }
+                    // top, bottom
+                    if (y > 0)
+                        this->template ComputeEdgeWeights<TDirection>(row, row - rowStride, nx, this->m_Sigma, &capacities[4][v], backward.data());
+                    if (y + 1 < ny)
+                        this->template ComputeEdgeWeights<TDirection>(row, row + rowStride, nx, this->m_Sigma, &capacities[5][v], backward.data());
+                    // back, front
+                    if (z > 0)
+                        this->template ComputeEdgeWeights<TDirection>(row, row - sliceStride, nx, this->m_Sigma, &capacities[6][v], backward.data());
+                    if (z + 1 < nz)
+                        this->template ComputeEdgeWeights<TDirection>(row, row + sliceStride, nx, this->m_Sigma, &capacities[7][v], backward.data());
+                }
+            }
+        });
+    }
+
     template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
     void ImageGridCutFilter <TImage, TForeground, TBackground, TOutput>
     ::CutGraph(ImageContainer images, ProgressReporter &progress){
@@ -149,8 +129,10 @@ namespace itk {
 
         int sourceGroup = groupOfSource();
         while (!outputImageIterator.IsAtEnd()) {
+            // the grid starts at the input region
             itk::Index<3> voxelIndex = outputImageIterator.GetIndex();
-            if (groupOf(voxelIndex[0], voxelIndex[1], voxelIndex[2]) == sourceGroup) {
+            itk::Index<3> start = images.inputRegion.GetIndex();
+            if (groupOf(voxelIndex[0] - start[0], voxelIndex[1] - start[1], voxelIndex[2] - start[2]) == sourceGroup) {
                 outputImageIterator.Set(this->m_ForegroundPixelValue);
             }
                 // Libraries differ to some degree in how they define the terminal groups. however, the tested ones
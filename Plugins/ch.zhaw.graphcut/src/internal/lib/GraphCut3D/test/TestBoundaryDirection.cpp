@@ -0,0 +1,148 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+#include <gtest/gtest.h>
+
+// ITK
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+
+#include "lib/gridcut/config.h"
+#include "ImageGraphCut3DKolmogorovFilter.hxx"
+#include "ImageGraphCut3DSupervoxelFilter.hxx"
+#ifdef GRIDCUT_LIBRARY_AVAILABLE
+#include "ImageGridCutFilter.hxx"
+#endif
+
+// image types
+typedef itk::Image<short, 3> TInput;
+typedef itk::Image<unsigned char, 3> TMask;
+
+// backend specific parameters
+template<typename TFilter>
+void ConfigureBackend(TFilter *) {
+}
+
+// one voxel per supervoxel, so the expected cuts below hold for the supervoxel graph as well as for the refined band
+template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+void ConfigureBackend(itk::ImageGraphCut3DSupervoxelFilter<TImage, TForeground, TBackground, TOutput> *filter) {
+    filter->SetSupervoxelSize(1);
+    filter->SetRefinementBandWidth(2);
+}
+
+/*
+ * A 3x3x3 cube in the center of a 10x10x10 image, with one foreground seed in its center and background seeds on the
+ * whole outer shell of the image.
+ *
+ * The boundary between the cube and its surrounding is only cheap to cut if the boundary direction matches the
+ * intensities (BrightDark for a bright cube, DarkBright for a dark cube). Otherwise every edge costs 1. The cut around
+ * the foreground seed (6 edges) is then cheaper than the one around the cube (54) or the shell (384), so it is the
+ * unique minimum.
+ */
+template<typename TFilter>
+class TestBoundaryDirection : public ::testing::Test {
+protected:
+    typename TMask::Pointer Segment(bool brightCube, bool brightDark) {
+        itk::Index<3> start = {{0, 0, 0}};
+        itk::Size<3> size = {{10, 10, 10}};
+        TInput::RegionType region(start, size);
+
+        TInput::Pointer input = TInput::New();
+        input->SetRegions(region);
+        input->Allocate();
+        input->FillBuffer(brightCube ? 0 : 1000);
+
+        typename TMask::Pointer foreground = TMask::New();
+        foreground->SetRegions(region);
+        foreground->Allocate();
+        foreground->FillBuffer(0);
+
+        typename TMask::Pointer background = TMask::New();
+        background->SetRegions(region);
+        background->Allocate();
+        background->FillBuffer(0);
+
+        for (int z = 4; z < 7; ++z) {
+            for (int y = 4; y < 7; ++y) {
+                for (int x = 4; x < 7; ++x) {
+                    itk::Index<3> index = {{x, y, z}};
+                    input->SetPixel(index, brightCube ? 1000 : 0);
+                }
+            }
+        }
+        itk::Index<3> center = {{5, 5, 5}};
+        foreground->SetPixel(center, 1);
+        for (int z = 0; z < 10; ++z) {
+            for (int y = 0; y < 10; ++y) {
+                for (int x = 0; x < 10; ++x) {
+                    if (x == 0 || x == 9 || y == 0 || y == 9 || z == 0 || z == 9) {
+                        itk::Index<3> index = {{x, y, z}};
+                        background->SetPixel(index, 1);
+                    }
+                }
+            }
+        }
+
+        typename TFilter::Pointer filter = TFilter::New();
+        filter->SetInputImage(input);
+        filter->SetForegroundImage(foreground);
+        filter->SetBackgroundImage(background);
+        filter->SetForegroundPixelValue(1);
+        filter->SetBackgroundPixelValue(0);
+        filter->SetSigma(50.0);
+        if (brightDark) {
+            filter->SetBoundaryDirectionTypeToBrightDark();
+        } else {
+            filter->SetBoundaryDirectionTypeToDarkBright();
+        }
+        ConfigureBackend(filter.GetPointer());
+        filter->Update();
+        return filter->GetOutput();
+    }
+
+    unsigned int CountForeground(const TMask *mask) {
+        unsigned int count = 0;
+        itk::ImageRegionConstIterator<TMask> it(mask, mask->GetLargestPossibleRegion());
+        for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+            count += it.Get() > 0;
+        }
+        return count;
+    }
+};
+
+typedef ::testing::Types<
+        itk::ImageGraphCut3DKolmogorovFilter<TInput, TMask, TMask, TMask>
+        , itk::ImageGraphCut3DKolmogorovFilter<TInput, TMask, TMask, TMask, int>
+        , itk::ImageGraphCut3DKolmogorovFilter<TInput, TMask, TMask, TMask, short>
+        , itk::ImageGraphCut3DSupervoxelFilter<TInput, TMask, TMask, TMask>
+#ifdef GRIDCUT_LIBRARY_AVAILABLE
+        , itk::ImageGridCutFilter<TInput, TMask, TMask, TMask>
+#endif
+> Backends;
+TYPED_TEST_CASE(TestBoundaryDirection, Backends);
+
+TYPED_TEST(TestBoundaryDirection, BrightCubeBrightDark){
+    TMask::Pointer result = this->Segment(true, true);
+    ASSERT_EQ(3u * 3u * 3u, this->CountForeground(result));
+}
+
+TYPED_TEST(TestBoundaryDirection, BrightCubeDarkBright){
+    TMask::Pointer result = this->Segment(true, false);
+    ASSERT_EQ(1u, this->CountForeground(result));
+}
+
+TYPED_TEST(TestBoundaryDirection, DarkCubeDarkBright){
+    TMask::Pointer result = this->Segment(false, false);
+    ASSERT_EQ(3u * 3u * 3u, this->CountForeground(result));
+}
+
+TYPED_TEST(TestBoundaryDirection, DarkCubeBrightDark){
+    TMask::Pointer result = this->Segment(false, true);
+    ASSERT_EQ(1u, this->CountForeground(result));
+}
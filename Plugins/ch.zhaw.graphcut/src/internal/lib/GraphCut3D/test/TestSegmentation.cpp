@@ -13,9 +13,11 @@
 #include <itkImage.h>
 #include <itkSubtractImageFilter.h>
 #include <itkStatisticsImageFilter.h>
+#include <itkImageRegionConstIterator.h>
 
 #include "IOHelper.hxx"
-#include "ImageGraphCut3DFilter.h"
+#include "GraphCut.h"
+#include "ImageGraphCut3DKolmogorovFilter.hxx"
 
 class TestSegmentation : public ::testing::Test {
 protected:
@@ -29,7 +31,7 @@ protected:
     typedef itk::Image<int, 3> TIntImage;
 
     // graphcut
-    typedef itk::ImageGraphCut3DFilter<TInput, TForeground, TBackground, TOutput> GraphCutFilterType;
+    typedef GraphCut::FilterType<TInput, TForeground, TBackground, TOutput> GraphCutFilterType;
 
     // image compare
     typedef itk::SubtractImageFilter<GraphCutFilterType::OutputImageType, TOutput, TIntImage> TDifferenceFilter;
@@ -44,6 +46,53 @@ protected:
 
     // virtual void TearDown() {}
 
+    // segments the images with a Kolmogorov filter using the given capacity type
+    template<typename TCapacity>
+    TOutput::Pointer segmentWithCapacity(TInput *input, TForeground *foreground, TBackground *background, bool brightDark) {
+        typedef itk::ImageGraphCut3DKolmogorovFilter<TInput, TForeground, TBackground, TOutput, TCapacity> FilterType;
+        typename FilterType::Pointer filter = FilterType::New();
+        filter->SetInputImage(input);
+        filter->SetForegroundImage(foreground);
+        filter->SetBackgroundImage(background);
+        filter->SetForegroundPixelValue(255);
+        filter->SetBackgroundPixelValue(0);
+        filter->SetSigma(50.0);
+        if (brightDark) {
+            filter->SetBoundaryDirectionTypeToBrightDark();
+        } else {
+            filter->SetBoundaryDirectionTypeToNoDirection();
+        }
+        filter->Update();
+        return filter->GetOutput();
+    }
+
+    // number of voxels that differ between two segmentations
+    unsigned int countDifferences(TOutput *a, TOutput *b) {
+        itk::ImageRegionConstIterator<TOutput> itA(a, a->GetLargestPossibleRegion());
+        itk::ImageRegionConstIterator<TOutput> itB(b, b->GetLargestPossibleRegion());
+        unsigned int differences = 0;
+        for (; !itA.IsAtEnd(); ++itA, ++itB) {
+            differences += itA.Get() != itB.Get();
+        }
+        return differences;
+    }
+
+    // compares integer capacity results against the float results
+    // the quantization may only flip voxels on (almost) equally expensive cuts, maxFraction bounds their share
+    void compareCapacityTypes(std::string inputPath, std::string foregroundPath, std::string backgroundPath, bool brightDark, double maxFraction) {
+        TInput::Pointer inputImage = IOHelper::readImage<TInput>(inputPath.c_str());
+        TForeground::Pointer foregroundMask = IOHelper::readImage<TForeground>(foregroundPath.c_str());
+        TBackground::Pointer backgroundMask = IOHelper::readImage<TBackground>(backgroundPath.c_str());
+
+        TOutput::Pointer floatResult = segmentWithCapacity<float>(inputImage, foregroundMask, backgroundMask, brightDark);
+        TOutput::Pointer intResult = segmentWithCapacity<int>(inputImage, foregroundMask, backgroundMask, brightDark);
+        TOutput::Pointer shortResult = segmentWithCapacity<short>(inputImage, foregroundMask, backgroundMask, brightDark);
+
+        double maxDifferences = maxFraction * floatResult->GetLargestPossibleRegion().GetNumberOfPixels();
+        ASSERT_LE(countDifferences(floatResult, intResult), maxDifferences);
+        ASSERT_LE(countDifferences(floatResult, shortResult), maxDifferences);
+    }
+
     // graphcut
     GraphCutFilterType::Pointer graphCutFilter;
 
@@ -242,4 +291,121 @@ TEST_F(TestSegmentation, SetPixelValues){
 
     double pixelSum = statisticsFilter->GetSum();
     ASSERT_DOUBLE_EQ(expectedPixelSum, pixelSum);
+}
+
+TEST_F(TestSegmentation, SupervoxelCubeGraphCutTest){
+    typedef itk::ImageGraphCut3DSupervoxelFilter<TInput, TForeground, TBackground, TOutput> SupervoxelFilterType;
+
+    // path to files
+    std::string inputPath = "data/test/cube10x10x10/cubeNoisy_0p01.mhd";
+    std::string forgroundPath = "data/test/cube10x10x10/foregroundMask.mhd";
+    std::string backgroundPath = "data/test/cube10x10x10/backgroundMask.mhd";
+    std::string expectedPath = "data/test/cube10x10x10/expectedResult.mhd";
+
+    // read the images
+    TInput::Pointer inputImage = IOHelper::readImage<TInput>(inputPath.c_str());
+    TForeground::Pointer foregroundMask = IOHelper::readImage<TForeground>(forgroundPath.c_str());
+    TBackground::Pointer backgroundMask = IOHelper::readImage<TBackground>(backgroundPath.c_str());
+    TOutput::Pointer expectedResultImage = IOHelper::readImage<TOutput>(expectedPath.c_str());
+
+    // set images
+    SupervoxelFilterType::Pointer supervoxelFilter = SupervoxelFilterType::New();
+    supervoxelFilter->SetInputImage(inputImage);
+    supervoxelFilter->SetForegroundImage(foregroundMask);
+    supervoxelFilter->SetBackgroundImage(backgroundMask);
+
+    // set parameters
+    supervoxelFilter->SetForegroundPixelValue(255);
+    supervoxelFilter->SetBackgroundPixelValue(0);
+    supervoxelFilter->SetSigma(50.0);
+    supervoxelFilter->SetBoundaryDirectionTypeToBrightDark();
+    supervoxelFilter->SetSupervoxelSize(3);
+    supervoxelFilter->SetRefinementBandWidth(2);
+
+    // compare the results: I_Result(x)-I_Expected(x)==0
+    substractFilter->SetInput1(supervoxelFilter->GetOutput());
+    substractFilter->SetInput2(expectedResultImage);
+    statisticsFilter->SetInput(substractFilter->GetOutput());
+    statisticsFilter->Update();
+
+    ASSERT_LT(supervoxelFilter->GetNumberOfSupervoxels(), 10u * 10u * 10u);
+    double pixelSum = statisticsFilter->GetSum();
+    ASSERT_DOUBLE_EQ(0, pixelSum);
+}
+
+TEST_F(TestSegmentation, IntegerCapacitiesCube){
+    compareCapacityTypes("data/test/cube10x10x10/cube.mhd", "data/test/cube10x10x10/foregroundMask.mhd", "data/test/cube10x10x10/backgroundMask.mhd", true, 0);
+}
+
+TEST_F(TestSegmentation, IntegerCapacitiesCubeWithNoise){
+    compareCapacityTypes("data/test/cube10x10x10/cubeNoisy_0p01.mhd", "data/test/cube10x10x10/foregroundMask.mhd", "data/test/cube10x10x10/backgroundMask.mhd", true, 0);
+}
+
+TEST_F(TestSegmentation, IntegerCapacitiesFemur){
+    compareCapacityTypes("data/test/left_femur/input.nrrd", "data/test/left_femur/foreground.nrrd", "data/test/left_femur/background.nrrd", false, 1e-4);
+}
+
+TEST_F(TestSegmentation, AutomaticCroppingCube){
+    // path to files
+    std::string inputPath = "data/test/cube10x10x10/cubeNoisy_0p01.mhd";
+    std::string forgroundPath = "data/test/cube10x10x10/foregroundMask.mhd";
+    std::string backgroundPath = "data/test/cube10x10x10/backgroundMask.mhd";
+    std::string expectedPath = "data/test/cube10x10x10/expectedResult.mhd";
+
+    // read the images
+    TInput::Pointer inputImage = IOHelper::readImage<TInput>(inputPath.c_str());
+    TForeground::Pointer foregroundMask = IOHelper::readImage<TForeground>(forgroundPath.c_str());
+    TBackground::Pointer backgroundMask = IOHelper::readImage<TBackground>(backgroundPath.c_str());
+    TOutput::Pointer expectedResultImage = IOHelper::readImage<TOutput>(expectedPath.c_str());
+
+    // set images
+    graphCutFilter->SetInputImage(inputImage);
+    graphCutFilter->SetForegroundImage(foregroundMask);
+    graphCutFilter->SetBackgroundImage(backgroundMask);
+
+    // set parameters
+    graphCutFilter->SetForegroundPixelValue(255);
+    graphCutFilter->SetBackgroundPixelValue(0);
+    graphCutFilter->SetSigma(50.0);
+    graphCutFilter->SetBoundaryDirectionTypeToBrightDark();
+    graphCutFilter->SetAutomaticCropping(true);
+    graphCutFilter->SetCroppingMargin(1);
+
+    // compare the results: I_Result(x)-I_Expected(x)==0
+    substractFilter->SetInput1(graphCutFilter->GetOutput());
+    substractFilter->SetInput2(expectedResultImage);
+    statisticsFilter->SetInput(substractFilter->GetOutput());
+    statisticsFilter->Update();
+
+    double pixelSum = statisticsFilter->GetSum();
+    ASSERT_DOUBLE_EQ(0, pixelSum);
+}
+
+TEST_F(TestSegmentation, AutomaticCroppingFemur){
+    // path to files
+    std::string inputPath = "data/test/left_femur/input.nrrd";
+    std::string forgroundPath = "data/test/left_femur/foreground.nrrd";
+    std::string backgroundPath = "data/test/left_femur/background.nrrd";
+
+    // read the images
+    TInput::Pointer inputImage = IOHelper::readImage<TInput>(inputPath.c_str());
+    TForeground::Pointer foregroundMask = IOHelper::readImage<TForeground>(forgroundPath.c_str());
+    TBackground::Pointer backgroundMask = IOHelper::readImage<TBackground>(backgroundPath.c_str());
+
+    // the full graph
+    TOutput::Pointer fullResult = segmentWithCapacity<float>(inputImage, foregroundMask, backgroundMask, false);
+
+    // the cropped graph
+    graphCutFilter->SetInputImage(inputImage);
+    graphCutFilter->SetForegroundImage(foregroundMask);
+    graphCutFilter->SetBackgroundImage(backgroundMask);
+    graphCutFilter->SetForegroundPixelValue(255);
+    graphCutFilter->SetBackgroundPixelValue(0);
+    graphCutFilter->SetSigma(50.0);
+    graphCutFilter->SetBoundaryDirectionTypeToNoDirection();
+    graphCutFilter->SetAutomaticCropping(true);
+    graphCutFilter->SetCroppingMargin(10);
+    graphCutFilter->Update();
+
+    ASSERT_EQ(0u, countDifferences(fullResult, graphCutFilter->GetOutput()));
 }
\ No newline at end of file
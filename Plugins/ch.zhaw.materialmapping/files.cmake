@@ -7,18 +7,42 @@ set(INTERNAL_CPP_FILES
   BoneDensityParameters.cpp
   BoneDensityFunctor.cpp
   CalibrationDataModel.cpp
+  CalibrationFit.cpp
+  DistanceTransform.cpp
+  ElasticityImageCache.cpp
+  ElasticityKernel.cpp
+  ExtendImageKernel.cpp
+  ExtendSurfaceKernel.cpp
   GuiHelpers.cpp
   MaterialMappingFilter.cpp
   MaterialMappingHelper.cpp
+  MaterialMappingJob.cpp
   MaterialMappingView.cpp
   PowerLawFunctor.cpp
   PowerLawParameters.cpp
   PowerLawWidget.cpp
   PowerLawWidgetManager.cpp
+  TetraQuadrature.cpp
+  TetraVoxelizer.cpp
+  VerboseImageWriter.cpp
   test/BoneDensityTest.cpp
+  test/CalibrationFitTest.cpp
+  test/DistanceTransformTest.cpp
+  test/ElasticityImageCacheTest.cpp
+  test/ElasticityKernelTest.cpp
+  test/ExtendImageKernelTest.cpp
+  test/ExtendSurfaceKernelTest.cpp
   test/GridComparator.cpp
+  test/LinearImageSamplerTest.cpp
+  test/MaterialMappingFilterTest.cpp
+  test/MaterialMappingHelperTest.cpp
+  test/MaterialMappingJobTest.cpp
+  test/ParallelForTest.cpp
   test/PowerLawFunctorTest.cpp
   test/PowerLawWidgetTest.cpp
+  test/TetraQuadratureTest.cpp
+  test/TetraVoxelizerTest.cpp
+  test/VerboseImageWriterTest.cpp
   test/Runner.cpp
 )
 
@@ -33,4 +33,12 @@ void BoneDensityFunctor::SetRhoAsh(BoneDensityParameters::RhoAsh _rhoAsh) {
 
 void BoneDensityFunctor::SetRhoApp(BoneDensityParameters::RhoApp _rhoApp) {
     m_RhoApp = _rhoApp;
-}
\ No newline at end of file
+}
+
+double BoneDensityFunctor::GetSlope() const {
+    return m_RhoCt.slope / (m_RhoAsh.divisor * m_RhoApp.divisor);
+}
+
+double BoneDensityFunctor::GetIntercept() const {
+    return (m_RhoCt.offset + m_RhoAsh.offset) / (m_RhoAsh.divisor * m_RhoApp.divisor);
+}
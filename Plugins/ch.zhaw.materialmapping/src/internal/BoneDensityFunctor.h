@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <ostream>
 
 #include "BoneDensityParameters.h"
@@ -20,6 +21,26 @@ public:
         return (((_ct * m_RhoCt.slope + m_RhoCt.offset) + m_RhoAsh.offset) / m_RhoAsh.divisor) / m_RhoApp.divisor;
     }
 
+    /**
+     * rho_ct, rho_ash and rho_app folded into rho = slope * ct + intercept. Differs from operator() by a few ulp.
+     */
+    double GetSlope() const;
+    double GetIntercept() const;
+
+    /**
+     * Bone density for _n ct values, e.g. a float or integer image buffer, into float or double values. The constants
+     * are folded once, so the loop has neither divisions nor calls and auto-vectorizes. Evaluated in double precision.
+     * _in and _out may point to the same buffer.
+     */
+    template<class TPixel, class TOut>
+    void Apply(const TPixel *_in, TOut *_out, std::size_t _n) const {
+        const auto slope = GetSlope();
+        const auto intercept = GetIntercept();
+        for (std::size_t i = 0; i < _n; ++i) {
+            _out[i] = static_cast<TOut>(static_cast<double>(_in[i]) * slope + intercept);
+        }
+    }
+
     void SetRhoCt(BoneDensityParameters::RhoCt _rhoCt);
     void SetRhoAsh(BoneDensityParameters::RhoAsh _rhoAsh);
     void SetRhoApp(BoneDensityParameters::RhoApp _rhoApp);
@@ -3,12 +3,8 @@
 #include <QTextStream>
 #include <mitkLogMacros.h>
 
-#include <vnl/algo/vnl_lsqr.h>
-#include <vnl/vnl_sparse_matrix_linear_system.h>
-#include <vnl/vnl_least_squares_function.h>
-
-
 #include "CalibrationDataModel.h"
+#include "CalibrationFit.h"
 
 #include <stdexcept>
 
@@ -110,27 +106,13 @@ void CalibrationDataModel::clear() {
 }
 
 BoneDensityParameters::RhoCt CalibrationDataModel::getFittedLine() const {
-    vnl_vector<double> x(2);
-    x[0] = x[1] = 0.0;
-
-    if(m_Data.size() > 1) { // on windows, lsqr.minimize crashes when called with too few data points
-        vnl_sparse_matrix<double> A(m_Data.size(), 2);
-        vnl_vector<double> b(m_Data.size());
-
-        auto factor = 1.0;
-        m_SelectedUnit == Unit::mgHA_cm3 ? factor = 1000.0 : 1.0;
-        for (auto i = 0; i < m_Data.size(); ++i) {
-            A(i, 0) = m_Data[i].first;
-            A(i, 1) = 1;
-            b[i] = m_Data[i].second / factor;
-        }
-        vnl_sparse_matrix_linear_system<double> ls(A, b);
-
-        vnl_lsqr lsqr(ls);
-        lsqr.minimize(x);
+    CalibrationFit fit;
+    auto factor = 1.0;
+    m_SelectedUnit == Unit::mgHA_cm3 ? factor = 1000.0 : 1.0;
+    for (auto i = 0; i < m_Data.size(); ++i) {
+        fit.addPoint(m_Data[i].first, m_Data[i].second / factor);
     }
-
-    return BoneDensityParameters::RhoCt(x[0], x[1]);
+    return fit.fit();
 }
 
 std::string CalibrationDataModel::getUnitString() const {
@@ -46,7 +46,8 @@ public:
     bool hasExpectedValueRange() const;
 
     /**
-     * Returns a fitted curve for the currently entered calibration values using a least squares fitting
+     * Returns a fitted curve for the currently entered calibration values using a least squares fitting, see
+     * CalibrationFit
      */
     BoneDensityParameters::RhoCt getFittedLine() const;
 
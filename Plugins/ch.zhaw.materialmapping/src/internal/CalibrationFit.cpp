@@ -0,0 +1,78 @@
+#include "CalibrationFit.h"
+
+const double CalibrationFit::MinimumVoxelVariance = 1.0 / 12;
+
+void CalibrationFit::Statistics::add(double _value) {
+    count += 1;
+    auto delta = _value - mean;
+    mean += delta / count;
+    m2 += delta * (_value - mean);
+}
+
+void CalibrationFit::Statistics::merge(const Statistics &_other) {
+    if (_other.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        *this = _other;
+        return;
+    }
+    auto total = count + _other.count;
+    auto delta = _other.mean - mean;
+    mean += delta * _other.count / total;
+    m2 += _other.m2 + delta * delta * count * _other.count / total;
+    count = total;
+}
+
+double CalibrationFit::Statistics::getVariance() const {
+    return count > 0 ? m2 / count : 0;
+}
+
+CalibrationFit::CalibrationFit()
+        : m_OutlierSigmas(0) {
+}
+
+void CalibrationFit::setOutlierRejection(double _sigmas) {
+    m_OutlierSigmas = _sigmas;
+}
+
+void CalibrationFit::addPoint(double _hu, double _rho, double _huStandardError) {
+    Point point = {_hu, _rho, 1 / (_huStandardError * _huStandardError)};
+    m_Points.push_back(point);
+}
+
+const std::vector<CalibrationFit::Point> &CalibrationFit::getPoints() const {
+    return m_Points;
+}
+
+void CalibrationFit::clear() {
+    m_Points.clear();
+}
+
+BoneDensityParameters::RhoCt CalibrationFit::fit() const {
+    if (m_Points.size() < 2) {
+        return BoneDensityParameters::RhoCt(0, 0);
+    }
+
+    double sumWeights = 0, meanHu = 0, meanRho = 0;
+    for (const auto &point : m_Points) {
+        sumWeights += point.weight;
+        meanHu += point.weight * point.hu;
+        meanRho += point.weight * point.rho;
+    }
+    if (sumWeights <= 0) {
+        return BoneDensityParameters::RhoCt(0, 0);
+    }
+    meanHu /= sumWeights;
+    meanRho /= sumWeights;
+
+    double sxx = 0, sxy = 0;
+    for (const auto &point : m_Points) {
+        auto dx = point.hu - meanHu;
+        sxx += point.weight * dx * dx;
+        sxy += point.weight * dx * (point.rho - meanRho);
+    }
+
+    auto slope = sxx > 0 ? sxy / sxx : 0;
+    return BoneDensityParameters::RhoCt(slope, meanRho - slope * meanHu);
+}
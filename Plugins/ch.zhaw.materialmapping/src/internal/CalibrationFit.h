@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "BoneDensityParameters.h"
+#include "ParallelFor.h"
+
+/**
+ * Weighted least squares fit of the calibration line rho = slope * HU + offset. Does not depend on Qt, the result can be
+ * passed to BoneDensityFunctor::SetRhoCt directly.
+ *
+ * A point is either a single calibration value (e.g. a row of the calibration table) or a phantom insert: the voxels of
+ * an image ROI with known density. An insert is reduced to the mean HU of its voxels in a parallel pass. Optionally, a
+ * second pass rejects the voxels further than a given number of standard deviations from the mean of their insert.
+ *
+ * Every point is weighted by the inverse variance of its HU value, 1 / standard error^2. For a single value the caller
+ * passes the standard error, 1 HU by default, so calibration table rows weigh the same. For an insert it is the standard
+ * error of the mean, stddev / sqrt(voxels). The voxel variance is at least 1/12, the quantization of integer HU, so
+ * uniform inserts do not get an infinite weight.
+ *
+ * The fit works on the deviations from the weighted means instead of the normal equations, so HU values far from 0 do
+ * not cancel out.
+ */
+class CalibrationFit {
+public:
+    struct Point {
+        double hu;
+        double rho;
+        double weight; // 1 / variance of hu
+    };
+
+    /**
+     * Count, mean and sum of squared deviations of a set of values. Partial statistics of any split of the values can be
+     * merged (Chan et al.).
+     */
+    struct Statistics {
+        double count = 0;
+        double mean = 0;
+        double m2 = 0;
+
+        void add(double _value);
+        void merge(const Statistics &_other);
+        double getVariance() const;
+    };
+
+    CalibrationFit();
+
+    /**
+     * Voxels further than _sigmas standard deviations from the mean of their insert are ignored. 0 (default) keeps all.
+     */
+    void setOutlierRejection(double _sigmas);
+
+    /**
+     * Adds a single value. _huStandardError has to be > 0.
+     */
+    void addPoint(double _hu, double _rho, double _huStandardError = 1);
+
+    /**
+     * Adds an insert of density _rho. Its voxels are the ones with a non-zero mask value, all _n voxels if _mask is
+     * nullptr. Returns false if there are none.
+     */
+    template<class TPixel>
+    bool addInsert(const TPixel *_image, const unsigned char *_mask, std::size_t _n, double _rho);
+
+    const std::vector<Point> &getPoints() const;
+    void clear();
+
+    /**
+     * 0 for both parameters with less than 2 points. The slope is 0 if all points have the same HU.
+     */
+    BoneDensityParameters::RhoCt fit() const;
+
+private:
+    // statistics of the masked voxels within _radius of _center
+    template<class TPixel>
+    static Statistics computeStatistics(const TPixel *_image, const unsigned char *_mask, std::size_t _n,
+                                        double _center, double _radius);
+
+    // variance of integer HU values rounded from a uniform distribution
+    static const double MinimumVoxelVariance;
+
+    double m_OutlierSigmas;
+    std::vector<Point> m_Points;
+};
+
+template<class TPixel>
+bool CalibrationFit::addInsert(const TPixel *_image, const unsigned char *_mask, std::size_t _n, double _rho) {
+    auto statistics = computeStatistics(_image, _mask, _n, 0, std::numeric_limits<double>::infinity());
+    if (statistics.count == 0) {
+        return false;
+    }
+
+    if (m_OutlierSigmas > 0) {
+        auto radius = m_OutlierSigmas * std::sqrt(statistics.getVariance());
+        auto inliers = computeStatistics(_image, _mask, _n, statistics.mean, radius);
+        // e.g. two clusters and _sigmas < 1: no voxel is close to the mean
+        if (inliers.count > 0) {
+            statistics = inliers;
+        }
+    }
+
+    auto variance = std::max(statistics.getVariance(), MinimumVoxelVariance);
+    Point point = {statistics.mean, _rho, statistics.count / variance};
+    m_Points.push_back(point);
+    return true;
+}
+
+template<class TPixel>
+CalibrationFit::Statistics CalibrationFit::computeStatistics(const TPixel *_image, const unsigned char *_mask,
+                                                             std::size_t _n, double _center, double _radius) {
+    std::vector<Statistics> partial(parallelForNumberOfThreads());
+    parallelFor(_n, [&](std::size_t _begin, std::size_t _end, unsigned int _threadId) {
+        Statistics statistics;
+        for (auto i = _begin; i < _end; ++i) {
+            if (_mask != nullptr && _mask[i] == 0) {
+                continue;
+            }
+            auto value = static_cast<double>(_image[i]);
+            if (std::abs(value - _center) <= _radius) {
+                statistics.add(value);
+            }
+        }
+        partial[_threadId] = statistics;
+    });
+
+    Statistics result;
+    for (const auto &statistics : partial) {
+        result.merge(statistics);
+    }
+    return result;
+}
@@ -0,0 +1,133 @@
+#include <limits>
+
+#include "DistanceTransform.h"
+#include "ParallelFor.h"
+
+void DistanceTransform::compute(const unsigned char *_mask, const int _dimensions[3], bool _invert) {
+    const std::ptrdiff_t nx = _dimensions[0], ny = _dimensions[1], nz = _dimensions[2];
+    const std::ptrdiff_t n = nx * ny * nz;
+    const auto infinity = std::numeric_limits<double>::infinity();
+
+    m_SquaredDistance.resize(n);
+    m_NearestSite.resize(n);
+    parallelFor(n, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int) {
+        for (auto i = _begin; i < _end; ++i) {
+            bool isSite = (_mask[i] != 0) != _invert;
+            m_SquaredDistance[i] = isSite ? 0 : infinity;
+            m_NearestSite[i] = isSite ? i : -1;
+        }
+    });
+
+    transformLines(nx, 1, ny * nz, nx, ny * nz, 0);      // x
+    transformLines(ny, nx, nx * nz, 1, nx, nx * ny);    // y
+    transformLines(nz, nx * ny, nx * ny, 1, nx * ny, 0); // z
+}
+
+void DistanceTransform::transformLines(std::ptrdiff_t _length, std::ptrdiff_t _stride, std::ptrdiff_t _numberOfLines,
+                                       std::ptrdiff_t _lineStride, std::ptrdiff_t _lineBlock,
+                                       std::ptrdiff_t _blockStride) {
+    const auto infinity = std::numeric_limits<double>::infinity();
+
+    parallelFor(_numberOfLines, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int) {
+        std::vector<double> f(_length), z(_length + 1);
+        std::vector<std::ptrdiff_t> site(_length), v(_length);
+
+        for (auto line = _begin; line < _end; ++line) {
+            auto start = (line % _lineBlock) * _lineStride + (line / _lineBlock) * _blockStride;
+            for (std::ptrdiff_t q = 0; q < _length; ++q) {
+                f[q] = m_SquaredDistance[start + q * _stride];
+                site[q] = m_NearestSite[start + q * _stride];
+            }
+
+            // lower envelope of the parabolas rooted at (q, f(q))
+            std::ptrdiff_t k = -1;
+            for (std::ptrdiff_t q = 0; q < _length; ++q) {
+                if (f[q] == infinity) {
+                    continue;
+                }
+                double s = 0;
+                while (k >= 0) {
+                    s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * q - 2.0 * v[k]);
+                    if (s <= z[k]) {
+                        --k;
+                    } else {
+                        break;
+                    }
+                }
+                if (k < 0) {
+                    k = 0;
+                    z[0] = -infinity;
+                } else {
+                    ++k;
+                    z[k] = s;
+                }
+                v[k] = q;
+                z[k + 1] = infinity;
+            }
+            if (k < 0) {
+                continue; // no site on this line
+            }
+
+            std::ptrdiff_t j = 0;
+            for (std::ptrdiff_t q = 0; q < _length; ++q) {
+                while (z[j + 1] < q) {
+                    ++j;
+                }
+                auto d = static_cast<double>(q - v[j]);
+                m_SquaredDistance[start + q * _stride] = d * d + f[v[j]];
+                m_NearestSite[start + q * _stride] = site[v[j]];
+            }
+        }
+    });
+}
+
+void DistanceTransform::dilate(const unsigned char *_mask, const int _dimensions[3], unsigned int _radius,
+                               unsigned char *_out) {
+    const std::ptrdiff_t nx = _dimensions[0], ny = _dimensions[1], nz = _dimensions[2];
+    const std::ptrdiff_t n = nx * ny * nz;
+    const auto radius = static_cast<std::ptrdiff_t>(_radius);
+
+    parallelFor(n, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int) {
+        for (auto i = _begin; i < _end; ++i) {
+            _out[i] = _mask[i] != 0;
+        }
+    });
+
+    // the box is the product of one interval per axis
+    dilateLines(_out, nx, 1, ny * nz, nx, ny * nz, 0, radius);      // x
+    dilateLines(_out, ny, nx, nx * nz, 1, nx, nx * ny, radius);    // y
+    dilateLines(_out, nz, nx * ny, nx * ny, 1, nx * ny, 0, radius); // z
+}
+
+void DistanceTransform::dilateLines(unsigned char *_image, std::ptrdiff_t _length, std::ptrdiff_t _stride,
+                                    std::ptrdiff_t _numberOfLines, std::ptrdiff_t _lineStride,
+                                    std::ptrdiff_t _lineBlock, std::ptrdiff_t _blockStride, std::ptrdiff_t _radius) {
+    parallelFor(_numberOfLines, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int) {
+        std::vector<unsigned char> line(_length);
+
+        for (auto lineIndex = _begin; lineIndex < _end; ++lineIndex) {
+            auto start = (lineIndex % _lineBlock) * _lineStride + (lineIndex / _lineBlock) * _blockStride;
+            for (std::ptrdiff_t q = 0; q < _length; ++q) {
+                line[q] = _image[start + q * _stride];
+            }
+
+            // distance to the previous and to the next set voxel of the line
+            std::ptrdiff_t previous = -1;
+            for (std::ptrdiff_t q = 0; q < _length; ++q) {
+                if (line[q]) {
+                    previous = q;
+                }
+                _image[start + q * _stride] = previous >= 0 && q - previous <= _radius;
+            }
+            std::ptrdiff_t next = -1;
+            for (auto q = _length - 1; q >= 0; --q) {
+                if (line[q]) {
+                    next = q;
+                }
+                if (next >= 0 && next - q <= _radius) {
+                    _image[start + q * _stride] = 1;
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Exact Euclidean distance transform of a 3D mask in voxel units, including the feature transform (index of the
+ * nearest site for every voxel).
+ *
+ * Separable lower envelope of parabolas (Felzenszwalb & Huttenlocher, Distance Transforms of Sampled Functions), one
+ * pass per axis, each parallel over the image lines. Linear in the number of voxels, independent of the distances.
+ */
+class DistanceTransform {
+public:
+    /**
+     * Sites are the voxels with _mask != 0, or with _mask == 0 if _invert is set. _dimensions in VTK order.
+     */
+    void compute(const unsigned char *_mask, const int _dimensions[3], bool _invert = false);
+
+    /**
+     * Squared distance to the nearest site. Infinity if there is no site at all.
+     */
+    inline double getSquaredDistance(std::ptrdiff_t _i) const {
+        return m_SquaredDistance[_i];
+    }
+
+    /**
+     * Index of the nearest site. -1 if there is no site at all.
+     */
+    inline std::ptrdiff_t getNearestSite(std::ptrdiff_t _i) const {
+        return m_NearestSite[_i];
+    }
+
+    /**
+     * Marks the voxels within Chebyshev distance _radius of a voxel with _mask != 0, i.e. the voxels _radius dilations
+     * with the 26-neighborhood reach. Separable, one pass per axis. _out must not alias _mask.
+     */
+    static void dilate(const unsigned char *_mask, const int _dimensions[3], unsigned int _radius, unsigned char *_out);
+
+private:
+    static void dilateLines(unsigned char *_image, std::ptrdiff_t _length, std::ptrdiff_t _stride,
+                            std::ptrdiff_t _numberOfLines, std::ptrdiff_t _lineStride, std::ptrdiff_t _lineBlock,
+                            std::ptrdiff_t _blockStride, std::ptrdiff_t _radius);
+
+    void transformLines(std::ptrdiff_t _length, std::ptrdiff_t _stride, std::ptrdiff_t _numberOfLines,
+                        std::ptrdiff_t _lineStride, std::ptrdiff_t _lineBlock, std::ptrdiff_t _blockStride);
+
+    std::vector<double> m_SquaredDistance;
+    std::vector<std::ptrdiff_t> m_NearestSite;
+};
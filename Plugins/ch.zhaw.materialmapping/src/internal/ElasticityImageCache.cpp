@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "ElasticityImageCache.h"
+
+namespace {
+    std::size_t getImageSize(vtkImageData *_image) {
+        return static_cast<std::size_t>(_image->GetNumberOfPoints()) * _image->GetScalarSize() *
+               _image->GetNumberOfScalarComponents();
+    }
+}
+
+bool ElasticityImageCache::Key::operator==(const Key &_other) const {
+    return image == _other.image && modifiedTime == _other.modifiedTime &&
+           std::equal(voiExtent, voiExtent + 6, _other.voiExtent) && border == _other.border &&
+           densityFunctor == _other.densityFunctor && powerLawFunctor == _other.powerLawFunctor;
+}
+
+ElasticityImageCache::ElasticityImageCache(std::size_t _memoryLimit)
+        : m_MemoryLimit(_memoryLimit)
+        , m_MemorySize(0) {
+}
+
+vtkSmartPointer<vtkImageData> ElasticityImageCache::get(const Key &_key) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = std::find_if(m_Entries.begin(), m_Entries.end(), [&](const Entry &_entry) {
+        return _entry.key == _key;
+    });
+    if (it == m_Entries.end()) {
+        return nullptr;
+    }
+
+    m_Entries.splice(m_Entries.begin(), m_Entries, it);
+    auto copy = vtkSmartPointer<vtkImageData>::New();
+    copy->DeepCopy(it->image);
+    return copy;
+}
+
+void ElasticityImageCache::add(const Key &_key, vtkImageData *_image) {
+    auto size = getImageSize(_image);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (size > m_MemoryLimit) {
+            return;
+        }
+    }
+    auto copy = vtkSmartPointer<vtkImageData>::New();
+    copy->DeepCopy(_image);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = std::find_if(m_Entries.begin(), m_Entries.end(), [&](const Entry &_entry) {
+        return _entry.key == _key;
+    });
+    if (it != m_Entries.end()) {
+        m_MemorySize -= it->size;
+        m_Entries.erase(it);
+    }
+
+    Entry entry = {_key, copy, size};
+    m_Entries.push_front(entry);
+    m_MemorySize += size;
+    evict();
+}
+
+void ElasticityImageCache::clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+    m_MemorySize = 0;
+}
+
+void ElasticityImageCache::setMemoryLimit(std::size_t _bytes) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MemoryLimit = _bytes;
+    evict();
+}
+
+std::size_t ElasticityImageCache::getMemorySize() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_MemorySize;
+}
+
+std::size_t ElasticityImageCache::getNumberOfEntries() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Entries.size();
+}
+
+void ElasticityImageCache::evict() {
+    while (m_MemorySize > m_MemoryLimit && !m_Entries.empty()) {
+        m_MemorySize -= m_Entries.back().size;
+        m_Entries.pop_back();
+    }
+}
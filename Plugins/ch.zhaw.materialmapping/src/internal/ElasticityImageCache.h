@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "BoneDensityFunctor.h"
+#include "PowerLawFunctor.h"
+
+/**
+ * Keeps the E images of recent material mapping runs, so re-running with the same CT and calibration (e.g. with a
+ * different minimum E or method) skips the functor evaluation.
+ *
+ * An entry is identified by the CT (object and modification time), the VOI with its border and both functors. The
+ * least recently used entries are dropped once the images exceed the memory limit. The cache is thread safe.
+ */
+class ElasticityImageCache {
+public:
+    struct Key {
+        const void *image;
+        unsigned long modifiedTime;
+        int voiExtent[6];
+        int border;
+        BoneDensityFunctor densityFunctor;
+        PowerLawFunctor powerLawFunctor;
+
+        bool operator==(const Key &_other) const;
+    };
+
+    static const std::size_t DefaultMemoryLimit = std::size_t(1) << 30;
+
+    explicit ElasticityImageCache(std::size_t _memoryLimit = DefaultMemoryLimit);
+
+    /**
+     * A copy of the cached image, since the mapping modifies its E image in place. nullptr if there is none.
+     */
+    vtkSmartPointer<vtkImageData> get(const Key &_key);
+
+    /**
+     * Stores a copy of _image. Images larger than the memory limit are not cached.
+     */
+    void add(const Key &_key, vtkImageData *_image);
+
+    void clear();
+    void setMemoryLimit(std::size_t _bytes);
+    std::size_t getMemorySize() const;
+    std::size_t getNumberOfEntries() const;
+
+private:
+    struct Entry {
+        Key key;
+        vtkSmartPointer<vtkImageData> image;
+        std::size_t size;
+    };
+
+    void evict();
+
+    // most recently used first
+    std::list<Entry> m_Entries;
+    std::size_t m_MemoryLimit;
+    std::size_t m_MemorySize;
+    mutable std::mutex m_Mutex;
+};
@@ -0,0 +1,22 @@
+#include "ElasticityKernel.h"
+
+#include "ParallelFor.h"
+
+ElasticityKernel::ElasticityKernel(const BoneDensityFunctor &_densityFunctor, const PowerLawFunctor &_powerLawFunctor)
+        : m_Slope(_densityFunctor.GetSlope())
+        , m_Intercept(_densityFunctor.GetIntercept())
+        , m_PowerLawFunctor(_powerLawFunctor) {
+}
+
+std::vector<float> ElasticityKernel::tabulate(long long _min, long long _max) const {
+    if (_max < _min) {
+        return std::vector<float>();
+    }
+    std::vector<float> table(static_cast<std::size_t>(_max - _min + 1));
+    parallelFor(table.size(), [&](std::size_t _begin, std::size_t _end, unsigned int) {
+        for (auto i = _begin; i < _end; ++i) {
+            table[i] = static_cast<float>((*this)(static_cast<double>(_min + static_cast<long long>(i))));
+        }
+    });
+    return table;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "BoneDensityFunctor.h"
+#include "PowerLawFunctor.h"
+
+/**
+ * Flattened, immutable form of BoneDensityFunctor followed by PowerLawFunctor (HU -> rho_app -> E) for whole buffers.
+ *
+ * - the density chain is folded into rho = slope * ct + intercept, as in BoneDensityFunctor::Apply
+ * - negative densities are clamped to 0, as in MaterialMappingFilter
+ * - the power law is selected through the compiled form of PowerLawFunctor
+ * - rho ^ exponent is evaluated as exp(exponent * log(rho)) in double precision
+ *
+ * Folding the constants and exp/log reorder the floating point operations. In double precision the results differ
+ * from the functors by a few ulp only, so the float output matches the functors within 1 float ulp (relative 1.2e-7).
+ *
+ * apply is a scalar loop: exp and log are library calls, which keep the compiler from vectorizing it. For integer
+ * images, tabulate evaluates every occurring ct value once instead.
+ *
+ * The kernel holds no mutable state and may be shared between threads.
+ */
+class ElasticityKernel {
+public:
+    ElasticityKernel(const BoneDensityFunctor &_densityFunctor, const PowerLawFunctor &_powerLawFunctor);
+
+    /**
+     * E for a single ct value.
+     */
+    inline double operator()(double _ct) const {
+        double rho = _ct * m_Slope + m_Intercept;
+        rho = rho > 0.0 ? rho : 0.0;
+
+        const auto &law = m_PowerLawFunctor.GetPowerLaw(m_PowerLawFunctor.SelectPowerLaw(rho));
+        double power = rho > 0.0 ? std::exp(law.exponent * std::log(rho)) : std::pow(rho, law.exponent);
+        return law.factor * power + law.offset;
+    }
+
+    /**
+     * E for _n ct values. _in and _out may point to the same buffer.
+     */
+    template<class TPixel>
+    void apply(const TPixel *_in, float *_out, std::size_t _n) const {
+        for (std::size_t i = 0; i < _n; ++i) {
+            _out[i] = static_cast<float>((*this)(static_cast<double>(_in[i])));
+        }
+    }
+
+    /**
+     * HU -> E lookup table with one entry per integer ct value in [_min, _max]. Entries are bit identical to apply.
+     */
+    std::vector<float> tabulate(long long _min, long long _max) const;
+
+private:
+    double m_Slope, m_Intercept;
+    PowerLawFunctor m_PowerLawFunctor;
+};
+
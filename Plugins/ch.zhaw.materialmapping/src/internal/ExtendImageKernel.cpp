@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ExtendImageKernel.h"
+#include "ParallelFor.h"
+
+namespace {
+    // 1 / distance for the 3x3x3 neighborhood, x fastest. Same values as the vtkImageConvolve kernel it replaces.
+    struct NeighborhoodWeights {
+        NeighborhoodWeights() {
+            const double byDistance[4] = {0, 1, 1 / sqrt(2), 1 / sqrt(3)};
+            for (auto z = 0; z < 3; ++z) {
+                for (auto y = 0; y < 3; ++y) {
+                    for (auto x = 0; x < 3; ++x) {
+                        w[x + 3 * y + 9 * z] = byDistance[(x != 1) + (y != 1) + (z != 1)];
+                    }
+                }
+            }
+        }
+
+        double w[27];
+    };
+
+    const NeighborhoodWeights weights;
+}
+
+ExtendImageKernel::ExtendImageKernel(float *_image, unsigned char *_mask, const int _dimensions[3])
+        : m_Image(_image)
+        , m_Mask(_mask)
+        , m_ThreadCandidates(parallelForNumberOfThreads())
+        , m_FrontierInitialized(false) {
+    for (auto i = 0; i < 3; ++i) {
+        m_Dimensions[i] = _dimensions[i];
+    }
+    m_IncrementY = m_Dimensions[0];
+    m_IncrementZ = m_Dimensions[0] * m_Dimensions[1];
+}
+
+std::size_t ExtendImageKernel::step(bool _maxVal) {
+    if (!m_FrontierInitialized) {
+        initializeFrontier();
+        m_FrontierInitialized = true;
+    } else {
+        updateFrontier();
+    }
+
+    // weighted averages from the state before this step
+    m_Values.resize(m_Frontier.size());
+    parallelFor(m_Frontier.size(), [&](std::size_t _begin, std::size_t _end, unsigned int) {
+        for (auto i = _begin; i < _end; ++i) {
+            auto index = m_Frontier[i];
+            auto z = index / m_IncrementZ;
+            auto y = (index - z * m_IncrementZ) / m_IncrementY;
+            auto x = index - z * m_IncrementZ - y * m_IncrementY;
+
+            double imageSum = 0, maskSum = 0;
+            for (auto dz = -1; dz <= 1; ++dz) {
+                if (z + dz < 0 || z + dz >= m_Dimensions[2]) {
+                    continue;
+                }
+                for (auto dy = -1; dy <= 1; ++dy) {
+                    if (y + dy < 0 || y + dy >= m_Dimensions[1]) {
+                        continue;
+                    }
+                    for (auto dx = -1; dx <= 1; ++dx) {
+                        if (x + dx < 0 || x + dx >= m_Dimensions[0]) {
+                            continue;
+                        }
+                        auto neighbor = index + dx + dy * m_IncrementY + dz * m_IncrementZ;
+                        if (m_Mask[neighbor]) {
+                            auto w = weights.w[(dx + 1) + 3 * (dy + 1) + 9 * (dz + 1)];
+                            float maskValue = m_Mask[neighbor];
+                            imageSum += w * (m_Image[neighbor] * maskValue);
+                            maskSum += w * maskValue;
+                        }
+                    }
+                }
+            }
+            m_Values[i] = static_cast<float>(imageSum) / static_cast<float>(maskSum);
+        }
+    });
+
+    parallelFor(m_Frontier.size(), [&](std::size_t _begin, std::size_t _end, unsigned int) {
+        for (auto i = _begin; i < _end; ++i) {
+            auto index = m_Frontier[i];
+            if (!_maxVal || m_Image[index] < m_Values[i]) {
+                m_Image[index] = m_Values[i];
+            }
+            m_Mask[index] = 1;
+        }
+    });
+
+    return m_Frontier.size();
+}
+
+bool ExtendImageKernel::isFrontier(std::ptrdiff_t _x, std::ptrdiff_t _y, std::ptrdiff_t _z) const {
+    auto index = _x + _y * m_IncrementY + _z * m_IncrementZ;
+    if (m_Mask[index]) {
+        return false;
+    }
+    for (auto z = std::max<std::ptrdiff_t>(0, _z - 1); z <= std::min(m_Dimensions[2] - 1, _z + 1); ++z) {
+        for (auto y = std::max<std::ptrdiff_t>(0, _y - 1); y <= std::min(m_Dimensions[1] - 1, _y + 1); ++y) {
+            for (auto x = std::max<std::ptrdiff_t>(0, _x - 1); x <= std::min(m_Dimensions[0] - 1, _x + 1); ++x) {
+                if (m_Mask[x + y * m_IncrementY + z * m_IncrementZ]) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void ExtendImageKernel::initializeFrontier() {
+    // full scan over z slabs. Chunks are contiguous and ordered, so the concatenation is sorted.
+    for (auto &candidates : m_ThreadCandidates) {
+        candidates.clear();
+    }
+    parallelFor(m_Dimensions[2], [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int _threadId) {
+        auto &candidates = m_ThreadCandidates[_threadId];
+        for (auto z = _begin; z < _end; ++z) {
+            for (std::ptrdiff_t y = 0; y < m_Dimensions[1]; ++y) {
+                for (std::ptrdiff_t x = 0; x < m_Dimensions[0]; ++x) {
+                    if (isFrontier(x, y, z)) {
+                        candidates.push_back(x + y * m_IncrementY + z * m_IncrementZ);
+                    }
+                }
+            }
+        }
+    });
+
+    m_Frontier.clear();
+    for (const auto &candidates : m_ThreadCandidates) {
+        m_Frontier.insert(m_Frontier.end(), candidates.begin(), candidates.end());
+    }
+}
+
+void ExtendImageKernel::updateFrontier() {
+    // every voxel next to a masked one was extended in the last step, so the new frontier consists of the unmasked
+    // neighbors of the last frontier
+    for (auto &candidates : m_ThreadCandidates) {
+        candidates.clear();
+    }
+    parallelFor(m_Frontier.size(), [&](std::size_t _begin, std::size_t _end, unsigned int _threadId) {
+        auto &candidates = m_ThreadCandidates[_threadId];
+        for (auto i = _begin; i < _end; ++i) {
+            auto index = m_Frontier[i];
+            auto z = index / m_IncrementZ;
+            auto y = (index - z * m_IncrementZ) / m_IncrementY;
+            auto x = index - z * m_IncrementZ - y * m_IncrementY;
+            for (auto nz = std::max<std::ptrdiff_t>(0, z - 1); nz <= std::min(m_Dimensions[2] - 1, z + 1); ++nz) {
+                for (auto ny = std::max<std::ptrdiff_t>(0, y - 1); ny <= std::min(m_Dimensions[1] - 1, y + 1); ++ny) {
+                    for (auto nx = std::max<std::ptrdiff_t>(0, x - 1); nx <= std::min(m_Dimensions[0] - 1, x + 1); ++nx) {
+                        auto neighbor = nx + ny * m_IncrementY + nz * m_IncrementZ;
+                        if (!m_Mask[neighbor]) {
+                            candidates.push_back(neighbor);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    m_Frontier.clear();
+    for (const auto &candidates : m_ThreadCandidates) {
+        m_Frontier.insert(m_Frontier.end(), candidates.begin(), candidates.end());
+    }
+    std::sort(m_Frontier.begin(), m_Frontier.end());
+    m_Frontier.erase(std::unique(m_Frontier.begin(), m_Frontier.end()), m_Frontier.end());
+}
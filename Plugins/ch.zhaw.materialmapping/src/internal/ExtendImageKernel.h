@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Extends a float image into the voxels around a mask ("New" method of MaterialMappingFilter).
+ *
+ * Every unmasked voxel with at least one masked 26-neighbor (the frontier) gets the inverse distance weighted average
+ * of its masked neighbors and becomes part of the mask. Optionally, the voxel keeps its value if it is larger.
+ *
+ * This yields the same values as multiplying image and mask and dividing two vtkImageConvolve passes with the
+ * 1/distance kernel: the weighted sums are accumulated in double, rounded to float and divided in float. Instead of
+ * convolving the whole image, only the frontier is visited. It is determined once by a full scan and then updated from
+ * the neighbors of the voxels extended in the previous step, so each step costs O(surface) instead of O(image).
+ *
+ * The buffers are used in place and have to stay valid for the lifetime of the kernel. Both must not be modified
+ * between steps by anyone else.
+ */
+class ExtendImageKernel {
+public:
+    ExtendImageKernel(float *_image, unsigned char *_mask, const int _dimensions[3]);
+
+    /**
+     * One extend step. Returns the number of extended voxels.
+     */
+    std::size_t step(bool _maxVal);
+
+private:
+    void initializeFrontier();
+    void updateFrontier();
+    bool isFrontier(std::ptrdiff_t _x, std::ptrdiff_t _y, std::ptrdiff_t _z) const;
+
+    float *m_Image;
+    unsigned char *m_Mask;
+    std::ptrdiff_t m_Dimensions[3];
+    std::ptrdiff_t m_IncrementY, m_IncrementZ;
+
+    // reused across steps
+    std::vector<std::ptrdiff_t> m_Frontier;
+    std::vector<float> m_Values;
+    std::vector<std::vector<std::ptrdiff_t>> m_ThreadCandidates;
+    bool m_FrontierInitialized;
+};
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ExtendSurfaceKernel.h"
+#include "ParallelFor.h"
+
+ExtendSurfaceKernel::ExtendSurfaceKernel()
+        : m_ThreadUpdates(parallelForNumberOfThreads()) {
+    // R = [p q p   [q 1 q   [p q p
+    //      q 1 q    1 0 1    q 1 q
+    //      p q p]   q 1 q]   p q p],  q = 1/sqrt(2), p = 1/sqrt(3)
+    const double byDistance[4] = {0, 1, 1.0 / sqrt(2.0), 1.0 / sqrt(3.0)};
+    for (auto i = 0; i < 3; ++i) {
+        for (auto j = 0; j < 3; ++j) {
+            for (auto k = 0; k < 3; ++k) {
+                m_R[i + 3 * (j + 3 * k)] = static_cast<float>(byDistance[(i != 1) + (j != 1) + (k != 1)]);
+            }
+        }
+    }
+}
+
+std::size_t ExtendSurfaceKernel::extend(float *_image, unsigned char *_mask, const int _dimensions[3], bool _maxVal) {
+    const std::ptrdiff_t nx = _dimensions[0], ny = _dimensions[1], nz = _dimensions[2];
+    const std::ptrdiff_t incrementY = nx, incrementZ = nx * ny;
+
+    // read only pass: collect the extended voxels
+    for (auto &updates : m_ThreadUpdates) {
+        updates.clear();
+    }
+    if (nx > 2 && ny > 2 && nz > 2) {
+        parallelFor(nz - 2, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int _threadId) {
+            auto &updates = m_ThreadUpdates[_threadId];
+            for (auto z = _begin + 1; z < _end + 1; ++z) {
+                for (std::ptrdiff_t y = 1; y < ny - 1; ++y) {
+                    for (std::ptrdiff_t x = 1; x < nx - 1; ++x) {
+                        auto index = x + y * incrementY + z * incrementZ;
+                        if (_mask[index]) {
+                            continue;
+                        }
+
+                        // same order as extendsurface(): its i is y, j is x and k is z
+                        float s = 0, t = 0;
+                        for (auto i = -1; i < 2; ++i) {
+                            for (auto j = -1; j < 2; ++j) {
+                                for (auto k = -1; k < 2; ++k) {
+                                    auto neighbor = index + j + i * incrementY + k * incrementZ;
+                                    int c = _mask[neighbor];
+                                    float r = m_R[(i + 1) + 3 * ((j + 1) + 3 * (k + 1))];
+                                    s += r * c;
+                                    t += (r * _image[neighbor] * c);
+                                }
+                            }
+                        }
+                        if (s) {
+                            updates.push_back(std::make_pair(index, t / s));
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    // write pass
+    std::size_t numberOfExtendedVoxels = 0;
+    for (const auto &updates : m_ThreadUpdates) {
+        for (const auto &update : updates) {
+            if (!_maxVal || _image[update.first] < update.second) {
+                _image[update.first] = update.second;
+            }
+            _mask[update.first] = 1;
+        }
+        numberOfExtendedVoxels += updates.size();
+    }
+
+    // border voxels are never part of the mask
+    for (std::ptrdiff_t z = 0; z < nz; ++z) {
+        for (std::ptrdiff_t y = 0; y < ny; ++y) {
+            auto row = _mask + y * incrementY + z * incrementZ;
+            if (z == 0 || y == 0 || z == nz - 1 || y == ny - 1) {
+                std::fill(row, row + nx, 0);
+            } else {
+                row[0] = 0;
+                row[nx - 1] = 0;
+            }
+        }
+    }
+
+    return numberOfExtendedVoxels;
+}
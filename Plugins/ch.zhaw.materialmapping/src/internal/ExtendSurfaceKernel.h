@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * C++ replacement of extendsurface() in lib/extendsurface3d.c ("Old" method of MaterialMappingFilter), applied in place.
+ *
+ * Every unmasked voxel with masked 26-neighbors gets the R filter weighted average of them and becomes part of the
+ * mask. Voxels on the image border are never extended and are removed from the mask, as in the original. The float
+ * arithmetic and summation order of the original are kept, so the results are identical.
+ *
+ * Differences to the C function:
+ * - iterates in VTK memory order (x fastest) and skips masked voxels after a single test
+ * - parallel over z-slabs. Only the changed voxels are buffered (per thread), instead of two full size copies.
+ * - the buffers are kept between calls, so repeated extend steps do not allocate
+ */
+class ExtendSurfaceKernel {
+public:
+    ExtendSurfaceKernel();
+
+    /**
+     * One extend step. _dimensions in VTK order. Returns the number of extended voxels.
+     */
+    std::size_t extend(float *_image, unsigned char *_mask, const int _dimensions[3], bool _maxVal);
+
+private:
+    float m_R[27];
+
+    // per thread: (index, value) of the extended voxels
+    std::vector<std::vector<std::pair<std::ptrdiff_t, float>>> m_ThreadUpdates;
+};
@@ -31,6 +31,9 @@ MaterialMappingFilter::Method gui::getSelectedMappingMethod(Ui::MaterialMappingV
     if(_controls.oldMethodRadioButton->isChecked()){
         return MaterialMappingFilter::Method::Old;
     }
+    if(_controls.distanceMethodRadioButton->isChecked()){
+        return MaterialMappingFilter::Method::DistanceTransform;
+    }
     assert(_controls.newMethodRadioButton->isChecked());
     return MaterialMappingFilter::Method::New;
 }
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vtkImageData.h>
+#include <vtkImageInterpolatorInternals.h>
+
+/**
+ * Trilinear sampling of a single component float image.
+ *
+ * Performs the same arithmetic as vtkImageInterpolator::Interpolate in linear mode with the default settings (clamp
+ * border mode, tolerance 2^-17, out value 0), including vtkInterpolationMath::Floor, so the results are identical.
+ * Unlike the interpolator, the sampler holds no mutable state and can be used from multiple threads at once.
+ */
+class LinearImageSampler {
+public:
+    LinearImageSampler(vtkImageData *_img)
+            : m_Scalars(static_cast<const float *>(_img->GetScalarPointer())) {
+        _img->GetExtent(m_Extent);
+        _img->GetOrigin(m_Origin);
+        _img->GetSpacing(m_Spacing);
+        m_IncrementY = m_Extent[1] - m_Extent[0] + 1;
+        m_IncrementZ = m_IncrementY * (m_Extent[3] - m_Extent[2] + 1);
+
+        const double defaultTolerance = 7.62939453125e-06; // vtkAbstractImageInterpolator
+        for (auto i = 0; i < 3; ++i) {
+            // flat dimensions accept half a voxel, see vtkAbstractImageInterpolator::Update
+            auto tolerance = m_Extent[2 * i] == m_Extent[2 * i + 1] ? 0.5 : defaultTolerance;
+            m_Bounds[2 * i] = m_Extent[2 * i] - tolerance;
+            m_Bounds[2 * i + 1] = m_Extent[2 * i + 1] + tolerance;
+        }
+    }
+
+    inline double operator()(double _x, double _y, double _z) const {
+        double p[3] = {
+                (_x - m_Origin[0]) / m_Spacing[0],
+                (_y - m_Origin[1]) / m_Spacing[1],
+                (_z - m_Origin[2]) / m_Spacing[2]
+        };
+        if (p[0] < m_Bounds[0] || p[0] > m_Bounds[1] || p[1] < m_Bounds[2] || p[1] > m_Bounds[3] || p[2] < m_Bounds[4] ||
+            p[2] > m_Bounds[5]) {
+            return 0.0;
+        }
+
+        double fx, fy, fz;
+        int inIdX0 = vtkInterpolationMath::Floor(p[0], fx);
+        int inIdY0 = vtkInterpolationMath::Floor(p[1], fy);
+        int inIdZ0 = vtkInterpolationMath::Floor(p[2], fz);
+
+        int inIdX1 = inIdX0 + (fx != 0);
+        int inIdY1 = inIdY0 + (fy != 0);
+        int inIdZ1 = inIdZ0 + (fz != 0);
+
+        inIdX0 = vtkInterpolationMath::Clamp(inIdX0, m_Extent[0], m_Extent[1]) - m_Extent[0];
+        inIdY0 = vtkInterpolationMath::Clamp(inIdY0, m_Extent[2], m_Extent[3]) - m_Extent[2];
+        inIdZ0 = vtkInterpolationMath::Clamp(inIdZ0, m_Extent[4], m_Extent[5]) - m_Extent[4];
+        inIdX1 = vtkInterpolationMath::Clamp(inIdX1, m_Extent[0], m_Extent[1]) - m_Extent[0];
+        inIdY1 = vtkInterpolationMath::Clamp(inIdY1, m_Extent[2], m_Extent[3]) - m_Extent[2];
+        inIdZ1 = vtkInterpolationMath::Clamp(inIdZ1, m_Extent[4], m_Extent[5]) - m_Extent[4];
+
+        vtkIdType factY0 = inIdY0 * m_IncrementY;
+        vtkIdType factY1 = inIdY1 * m_IncrementY;
+        vtkIdType factZ0 = inIdZ0 * m_IncrementZ;
+        vtkIdType factZ1 = inIdZ1 * m_IncrementZ;
+
+        vtkIdType i00 = factY0 + factZ0;
+        vtkIdType i01 = factY0 + factZ1;
+        vtkIdType i10 = factY1 + factZ0;
+        vtkIdType i11 = factY1 + factZ1;
+
+        double rx = 1 - fx;
+        double ry = 1 - fy;
+        double rz = 1 - fz;
+
+        double ryrz = ry * rz;
+        double fyrz = fy * rz;
+        double ryfz = ry * fz;
+        double fyfz = fy * fz;
+
+        const float *inPtr0 = m_Scalars + inIdX0;
+        const float *inPtr1 = m_Scalars + inIdX1;
+
+        return (rx * (ryrz * inPtr0[i00] + ryfz * inPtr0[i01] + fyrz * inPtr0[i10] + fyfz * inPtr0[i11]) +
+                fx * (ryrz * inPtr1[i00] + ryfz * inPtr1[i01] + fyrz * inPtr1[i10] + fyfz * inPtr1[i11]));
+    }
+
+private:
+    const float *m_Scalars;
+    int m_Extent[6];
+    double m_Origin[3], m_Spacing[3];
+    double m_Bounds[6];
+    vtkIdType m_IncrementY, m_IncrementZ;
+};
@@ -1,27 +1,113 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
 #include <limits>
+#include <memory>
+#include <thread>
+#include <type_traits>
 
 #include <vtkDoubleArray.h>
 #include <vtkCellArray.h>
+#include <vtkCellTypes.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtkPointData.h>
 #include <vtkCellData.h>
-#include <vtkImageInterpolator.h>
 #include <vtkTetra.h>
-#include <vtkMetaImageWriter.h>
 #include <vtkUnstructuredGridGeometryFilter.h>
-#include <vtkExtractVOI.h>
 #include <vtkDataSetSurfaceFilter.h>
 #include <vtkPolyDataToImageStencil.h>
+#include <vtkImageStencil.h>
+#include <vtkExtractVOI.h>
 #include <vtkImageContinuousErode3D.h>
 #include <vtkImageLogic.h>
-#include <vtkImageMathematics.h>
-#include <vtkImageConvolve.h>
 #include <vtkImageCast.h>
-#include <vtkImageConstantPad.h>
+
+#include <itkExceptionObject.h>
 
 #include <mitkProgressBar.h>
 
 #include "MaterialMappingFilter.h"
+#include "DistanceTransform.h"
+#include "ElasticityKernel.h"
+#include "ExtendImageKernel.h"
+#include "ExtendSurfaceKernel.h"
+#include "ParallelFor.h"
+#include "LinearImageSampler.h"
+#include "TetraQuadrature.h"
+#include "TetraVoxelizer.h"
+
+namespace
+{
+	// parallel loops check for cancellation every this many items
+	const vtkIdType CancellationInterval = 4096;
+
+	vtkIdType getNumberOfVoxels(const int _extent[6])
+	{
+		return static_cast<vtkIdType>(_extent[1] - _extent[0] + 1) * (_extent[3] - _extent[2] + 1) * (_extent[5] - _extent[4] + 1);
+	}
+
+	const char* getMethodName(MaterialMappingFilter::Method _method)
+	{
+		switch (_method)
+		{
+		case MaterialMappingFilter::Method::Old:
+			return "old";
+		case MaterialMappingFilter::Method::New:
+			return "new";
+		case MaterialMappingFilter::Method::DistanceTransform:
+			return "distance transform";
+		}
+		return "";
+	}
+
+	// joins the thread when leaving the scope, also when an exception leaves it
+	class ThreadJoinGuard
+	{
+	public:
+		explicit ThreadJoinGuard(std::thread& _thread)
+			: m_Thread(_thread)
+		{
+		}
+
+		~ThreadJoinGuard()
+		{
+			if (m_Thread.joinable())
+			{
+				m_Thread.join();
+			}
+		}
+
+	private:
+		std::thread& m_Thread;
+	};
+
+	// reports the progress steps that are left when leaving the scope, so an aborted update does not leave the
+	// progress bar behind
+	class ProgressGuard
+	{
+	public:
+		explicit ProgressGuard(unsigned int& _remainingSteps)
+			: m_RemainingSteps(_remainingSteps)
+		{
+		}
+
+		~ProgressGuard()
+		{
+			if (m_RemainingSteps > 0)
+			{
+				mitk::ProgressBar::GetInstance()->Progress(m_RemainingSteps);
+				m_RemainingSteps = 0;
+			}
+		}
+
+	private:
+		unsigned int& m_RemainingSteps;
+	};
+}
 
 MaterialMappingFilter::MaterialMappingFilter()
         : m_PointArrayName("E"),
@@ -32,15 +118,21 @@ MaterialMappingFilter::MaterialMappingFilter()
 
 void MaterialMappingFilter::GenerateData()
 {
+	// a cancel only applies to the update that is running when it arrives
+	m_Cancelled = false;
+
 	mitk::UnstructuredGrid::Pointer inputGrid = const_cast<mitk::UnstructuredGrid *>(this->GetInput());
 	if (inputGrid.IsNull() || m_IntensityImage == nullptr || m_IntensityImage.IsNull())
 	{
 		return;
 	}
 
-	mitk::ProgressBar::GetInstance()->AddStepsToDo(7);
+	// the unpeeled output is only a separate branch if the main one is peeled
+	auto computeUnpeeled = m_DoPeelStep && (m_UnpeeledPointArrayName != "" || m_UnpeeledCellArrayName != "");
+	m_RemainingProgressSteps = computeUnpeeled ? 9 : 7;
+	mitk::ProgressBar::GetInstance()->AddStepsToDo(m_RemainingProgressSteps);
+	ProgressGuard progressGuard(m_RemainingProgressSteps);
 
-	auto importedVtkImage = const_cast<vtkImageData *>(m_IntensityImage->GetVtkImageData());
 	vtkSmartPointer<vtkUnstructuredGrid> vtkInputGrid = inputGrid->GetVtkUnstructuredGrid();
 
 	MITK_INFO("ch.zhaw.materialmapping") << "density functors";
@@ -49,132 +141,288 @@ void MaterialMappingFilter::GenerateData()
 
 	MITK_INFO("ch.zhaw.materialmapping") << "material mapping parameters";
 	MITK_INFO("ch.zhaw.materialmapping") << "peel step: " << m_DoPeelStep;
+	MITK_INFO("ch.zhaw.materialmapping") << "unpeeled output: " << computeUnpeeled;
 	MITK_INFO("ch.zhaw.materialmapping") << "image extend: " << m_NumberOfExtendImageSteps;
 	MITK_INFO("ch.zhaw.materialmapping") << "minimum element value: " << m_MinimumElementValue;
-	MITK_INFO("ch.zhaw.materialmapping") << "method: " << (m_Method == Method::Old ? "old" : "new");
-
-	// Bug in mitk::Image::GetVtkImageData(), Origin is wrong
-	// http://bugs.mitk.org/show_bug.cgi?id=5050
-	// since the memory is shared between vtk and mitk, manually correcting it will break rendering. For now,
-	// we'll create a copy and work with that.
-	// TODO: keep an eye on this
-	auto mitkOrigin = m_IntensityImage->GetGeometry()->GetOrigin();
-	auto vtkImage = vtkSmartPointer<vtkImageData>::New();
-	vtkImage->ShallowCopy(importedVtkImage);
-	vtkImage->SetOrigin(mitkOrigin[0], mitkOrigin[1], mitkOrigin[2]);
+	MITK_INFO("ch.zhaw.materialmapping") << "element integration order: " << m_ElementIntegrationOrder;
+	MITK_INFO("ch.zhaw.materialmapping") << "method: " << getMethodName(m_Method);
+	MITK_INFO("ch.zhaw.materialmapping") << "precomputed E image: " << (m_ElasticityImage != nullptr);
 
+	// a writer left over from a cancelled update is flushed here
+	m_VerboseWriter.reset();
 	if (m_VerboseOutput)
 	{
-		writeMetaImageToVerboseOut("01_ct_input.mhd", vtkImage);
+		m_VerboseWriter.reset(new VerboseImageWriter(m_VerboseOutputDirectory));
+		m_VerboseWriter->setCompression(m_VerboseOutputCompression);
+		m_VerboseWriter->setDecimation(m_VerboseOutputDecimation);
+		if (m_HasVerboseOutputRegionOfInterest)
+		{
+			m_VerboseWriter->setRegionOfInterest(m_VerboseOutputRegionOfInterest);
+		}
 	}
 
-	// we would not gain anything by handling integer type scalars individually, so it's easier to work with floats from the beginning
-	auto imageCast = vtkSmartPointer<vtkImageCast>::New();
-	imageCast->SetInputData(vtkImage);
-	imageCast->SetOutputScalarTypeToFloat();
-	imageCast->Update();
-	vtkImage = imageCast->GetOutput();
-	mitk::ProgressBar::GetInstance()->Progress();
+	auto vtkImage = getIntensityVtkImage();
+	auto stageStart = std::chrono::steady_clock::now();
+	throwIfCancelled();
 
 	if (m_VerboseOutput)
 	{
-		writeMetaImageToVerboseOut("02_ct_casted.mhd", vtkImage);
+		writeMetaImageToVerboseOut("01_ct_input.mhd", vtkImage);
 	}
 
+	// crop first: only the VOI is ever converted to float. The padding with 0 slices for the extend steps is part of
+	// the same allocation.
 	auto surface = extractSurface(vtkInputGrid);
-	auto voi = extractVOI(vtkImage, surface);
+	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
+	int voiExtent[6];
+	computeVOIExtent(vtkImage, surface, border, voiExtent);
+	progress();
+	finishStage("voi", getNumberOfVoxels(voiExtent), stageStart);
 
 	if (m_VerboseOutput)
 	{
-		writeMetaImageToVerboseOut("03_ct_voi.mhd", vtkImage);
+		writeMetaImageToVerboseOut("03_ct_voi.mhd", extractVOI(vtkImage, voiExtent));
 	}
 
-	inplaceApplyFunctorsToImage(voi);
-	mitk::ProgressBar::GetInstance()->Progress();
+	auto voi = m_ElasticityImage != nullptr ? cropElasticityImage(m_ElasticityImage, voiExtent, border) : getElasticityImage(vtkImage, voiExtent, border);
+	progress();
+	throwIfCancelled();
+	finishStage("elasticity", voi->GetNumberOfPoints(), stageStart);
 
-	// pad with 0 slices
-	auto padder = vtkSmartPointer<vtkImageConstantPad>::New();
-	auto extent = voi->GetExtent();
-	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
-	int paddedExtents[6];
-	for (auto i = 0; i < 6; ++i)
+	VtkImage stencil;
+	stencil = createStencil(vtkInputGrid, voi);
+	progress();
+	throwIfCancelled();
+	finishStage("stencil", stencil->GetNumberOfPoints(), stageStart);
+
+	if (m_VerboseOutput)
 	{
-		paddedExtents[i] = extent[i] + border * (2 * (i % 2) - 1);
+		writeMetaImageToVerboseOut("04_e_voi.mhd", voi);
+		writeMetaImageToVerboseOut("05_stencil.mhd", stencil);
 	}
-	padder->SetInputData(voi);
-	padder->SetOutputWholeExtent(paddedExtents);
-	padder->SetConstant(0);
-	padder->Update();
-	voi = padder->GetOutput();
-
-	VtkImage stencil;
-	stencil = createStencil(surface, voi);
-	mitk::ProgressBar::GetInstance()->Progress();
 
+	// everything up to here is shared. The unpeeled branch works on its own copy of the E image and stencil, since the
+	// extend steps modify both in place. The guard joins the branch before anything it references goes out of scope,
+	// also if the peeled branch throws. Exceptions of the unpeeled branch are rethrown after the join.
+	VtkImage unpeeledVoi, unpeeledMask;
+	std::exception_ptr unpeeledError;
+	std::thread unpeeledBranch;
+	ThreadJoinGuard unpeeledBranchGuard(unpeeledBranch);
+	if (computeUnpeeled)
+	{
+		unpeeledVoi = vtkSmartPointer<vtkImageData>::New();
+		unpeeledVoi->DeepCopy(voi);
+		unpeeledMask = vtkSmartPointer<vtkImageData>::New();
+		unpeeledMask->DeepCopy(stencil);
+		unpeeledBranch = std::thread([&]()
+			{
+				try
+				{
+					inplaceExtendImageSteps(unpeeledVoi, unpeeledMask, "unpeeled_", "unpeeled ");
+				}
+				catch (...)
+				{
+					unpeeledError = std::current_exception();
+				}
+			});
+	}
 
 	MaterialMappingFilter::VtkImage mask;
 	if (m_DoPeelStep)
 	{
 		mask = createPeeledMask(voi, stencil);
+		finishStage("peel", mask->GetNumberOfPoints(), stageStart);
 	}
 	else
 	{
 		mask = stencil;
 	}
-	mitk::ProgressBar::GetInstance()->Progress();
 
 	if (m_VerboseOutput)
 	{
-		writeMetaImageToVerboseOut("04_e_voi.mhd", voi);
-		writeMetaImageToVerboseOut("05_stencil.mhd", stencil);
 		writeMetaImageToVerboseOut("06_peeled_mask.mhd", mask);
 	}
 
+	inplaceExtendImageSteps(voi, mask, "", "");
+	if (unpeeledBranch.joinable())
+	{
+		unpeeledBranch.join();
+	}
+	if (unpeeledError)
+	{
+		std::rethrow_exception(unpeeledError);
+	}
+	progress(2);
+	throwIfCancelled();
+
+    // create ouput. Points, cells and the existing arrays are shared with the input, the output only owns its
+    // attribute containers, so adding the E arrays leaves the input untouched.
+    auto out = vtkSmartPointer<vtkUnstructuredGrid>::New();
+    out->ShallowCopy(vtkInputGrid);
+
+	addNodeAndElementData(out, vtkInputGrid, voi, m_PointArrayName, m_CellArrayName, "");
+	if (computeUnpeeled)
+	{
+		addNodeAndElementData(out, vtkInputGrid, unpeeledVoi, m_UnpeeledPointArrayName, m_UnpeeledCellArrayName, "unpeeled ");
+	}
+
+	this->GetOutput()->SetVtkUnstructuredGrid(out);
+	m_VerboseWriter.reset(); // waits for the queued images
+}
+
+void MaterialMappingFilter::inplaceExtendImageSteps(VtkImage _img, VtkImage _mask, const std::string _verbosePrefix, const std::string _stagePrefix)
+{
+	if (m_Method == Method::DistanceTransform)
+	{
+		// all steps at once
+		auto start = std::chrono::steady_clock::now();
+		inplaceExtendImageByDistance(_img, _mask, m_NumberOfExtendImageSteps, true);
+		finishStage(_stagePrefix + "extend", _img->GetNumberOfPoints(), start);
+		if (m_VerboseOutput)
+		{
+			writeMetaImageToVerboseOut(_verbosePrefix + "07_peeled_mask_extended.mhd", _mask);
+			writeMetaImageToVerboseOut(_verbosePrefix + "08_e_voi_extended.mhd", _img);
+		}
+		return;
+	}
+
+	// the frontier of the new method is carried over from one step to the next, the old method reuses its buffers
+	std::unique_ptr<ExtendImageKernel> kernel;
+	ExtendSurfaceKernel oldKernel;
+	if (m_Method == Method::New)
+	{
+		assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+		kernel.reset(new ExtendImageKernel(static_cast<float *>(_img->GetScalarPointer()), static_cast<unsigned char *>(_mask->GetScalarPointer()), _img->GetDimensions()));
+	}
+
 	for (auto i = 0u; i < m_NumberOfExtendImageSteps; ++i)
 	{
+		// runs on the unpeeled branch thread as well, so stop without throwing
+		if (IsCancelled())
+		{
+			return;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::size_t extended = 0;
 		switch (m_Method)
 		{
 		case Method::Old:
 			{
-				inplaceExtendImageOld(voi, mask, true);
+				extended = oldKernel.extend(static_cast<float *>(_img->GetScalarPointer()), static_cast<unsigned char *>(_mask->GetScalarPointer()), _img->GetDimensions(), true);
+				_img->Modified();
+				_mask->Modified();
 				break;
 			}
 
 		case Method::New:
 			{
-				inplaceExtendImage(voi, mask, true);
+				extended = kernel->step(true);
+				_img->Modified();
+				_mask->Modified();
 				break;
 			}
+
+		case Method::DistanceTransform: // handled above
+			break;
 		}
+		finishStage(_stagePrefix + "extend " + std::to_string(i), extended, start);
 
 		if (m_VerboseOutput)
 		{
-			writeMetaImageToVerboseOut("07_peeled_mask_extended_" + std::to_string(i) + ".mhd", mask);
-			writeMetaImageToVerboseOut("08_e_voi_extended_" + std::to_string(i) + ".mhd", voi);
+			writeMetaImageToVerboseOut(_verbosePrefix + "07_peeled_mask_extended_" + std::to_string(i) + ".mhd", _mask);
+			writeMetaImageToVerboseOut(_verbosePrefix + "08_e_voi_extended_" + std::to_string(i) + ".mhd", _img);
 		}
 	}
-	mitk::ProgressBar::GetInstance()->Progress();
+}
 
-    // create ouput
-    auto out = vtkSmartPointer<vtkUnstructuredGrid>::New();
-    out->DeepCopy(vtkInputGrid);
+void MaterialMappingFilter::addNodeAndElementData(vtkUnstructuredGrid* _out, const VtkUGrid _mesh, const VtkImage _img, const std::string _pointArrayName, const std::string _cellArrayName, const std::string _stagePrefix)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto nodeDataE = interpolateToNodes(_mesh, _img, _pointArrayName, m_MinimumElementValue);
+	if (_pointArrayName != "")
+	{
+		_out->GetPointData()->AddArray(nodeDataE);
+	}
+	progress();
+	throwIfCancelled();
+	finishStage(_stagePrefix + "nodes", _mesh->GetNumberOfPoints(), start);
 
-	auto nodeDataE = interpolateToNodes(vtkInputGrid, voi, m_PointArrayName, m_MinimumElementValue);
-	if(m_PointArrayName != "")
+	if (_cellArrayName != "")
 	{
-		out->GetPointData()->AddArray(nodeDataE);
+		auto elementDataE = m_ElementIntegrationOrder > 0
+			? integrateElements(_mesh, _img, nodeDataE, _cellArrayName, m_MinimumElementValue)
+			: nodesToElements(_mesh, nodeDataE, _cellArrayName);
+		_out->GetCellData()->AddArray(elementDataE);
 	}
+	progress();
+	throwIfCancelled();
+	finishStage(_stagePrefix + "elements", _mesh->GetNumberOfCells(), start);
+}
 
-    mitk::ProgressBar::GetInstance()->Progress();
+void MaterialMappingFilter::finishStage(const std::string _stage, std::size_t _items, std::chrono::steady_clock::time_point& _start) const
+{
+	auto now = std::chrono::steady_clock::now();
+	if (m_StageCallback)
+	{
+		m_StageCallback(_stage, _items, std::chrono::duration<double>(now - _start).count());
+	}
+	_start = now;
+}
 
-    if(m_CellArrayName != "")
-    {
-        auto elementDataE = nodesToElements(vtkInputGrid, nodeDataE, m_CellArrayName);
-        out->GetCellData()->AddArray(elementDataE);
-    }
-    mitk::ProgressBar::GetInstance()->Progress();
+void MaterialMappingFilter::progress(unsigned int _steps)
+{
+	_steps = std::min(_steps, m_RemainingProgressSteps);
+	m_RemainingProgressSteps -= _steps;
+	mitk::ProgressBar::GetInstance()->Progress(_steps);
+}
 
-	this->GetOutput()->SetVtkUnstructuredGrid(out);
+void MaterialMappingFilter::throwIfCancelled()
+{
+	if (m_Cancelled)
+	{
+		MITK_INFO("ch.zhaw.materialmapping") << "cancelled";
+		throw itk::ProcessAborted(__FILE__, __LINE__);
+	}
+}
+
+vtkSmartPointer<vtkImageData> MaterialMappingFilter::CreateElasticityImage(const std::vector<mitk::UnstructuredGrid::Pointer>& _meshes)
+{
+	if (_meshes.empty() || m_IntensityImage.IsNull())
+	{
+		return nullptr;
+	}
+
+	auto vtkImage = getIntensityVtkImage();
+	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
+	int unionExtent[6];
+	for (std::size_t i = 0; i < _meshes.size(); ++i)
+	{
+		int voiExtent[6];
+		computeVOIExtent(vtkImage, extractSurface(_meshes[i]->GetVtkUnstructuredGrid()), border, voiExtent);
+		for (auto j = 0; j < 6; ++j)
+		{
+			auto isMin = j % 2 == 0;
+			unionExtent[j] = i == 0 ? voiExtent[j] : (isMin ? std::min(unionExtent[j], voiExtent[j]) : std::max(unionExtent[j], voiExtent[j]));
+		}
+	}
+
+	return getElasticityImage(vtkImage, unionExtent, border);
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::getIntensityVtkImage() const
+{
+	// Bug in mitk::Image::GetVtkImageData(), Origin is wrong
+	// http://bugs.mitk.org/show_bug.cgi?id=5050
+	// since the memory is shared between vtk and mitk, manually correcting it will break rendering. For now,
+	// we'll create a copy and work with that.
+	// TODO: keep an eye on this
+	auto importedVtkImage = const_cast<vtkImageData *>(m_IntensityImage->GetVtkImageData());
+	auto mitkOrigin = m_IntensityImage->GetGeometry()->GetOrigin();
+	auto vtkImage = vtkSmartPointer<vtkImageData>::New();
+	vtkImage->ShallowCopy(importedVtkImage);
+	vtkImage->SetOrigin(mitkOrigin[0], mitkOrigin[1], mitkOrigin[2]);
+	return vtkImage;
 }
 
 MaterialMappingFilter::VtkUGrid MaterialMappingFilter::extractSurface(const VtkUGrid _volMesh) const
@@ -188,9 +436,8 @@ MaterialMappingFilter::VtkUGrid MaterialMappingFilter::extractSurface(const VtkU
 	return surfaceFilter->GetOutput();
 }
 
-MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage _img, const VtkUGrid _surMesh) const
+void MaterialMappingFilter::computeVOIExtent(const VtkImage _img, const VtkUGrid _surMesh, int _border, int _voiExtent[6]) const
 {
-	auto voi = vtkSmartPointer<vtkExtractVOI>::New();
 	auto spacing = _img->GetSpacing();
 	auto origin = _img->GetOrigin();
 	auto extent = _img->GetExtent();
@@ -201,18 +448,20 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage
 			return x < a ? a : (x > b ? b : x);
 		};
 
-	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
-
-	int voiExt[6];
 	for (auto i = 0; i < 2; ++i)
 	{
 		for (auto j = 0; j < 3; ++j)
 		{
-			auto val = (bounds[i + 2 * j] - origin[j]) / spacing[j] + (2 * i - 1) * border; // coordinate -> index
-			voiExt[i + 2 * j] = clamp(val, extent[2 * j], extent[2 * j + 1]); // prevent wrap around
+			auto val = (bounds[i + 2 * j] - origin[j]) / spacing[j] + (2 * i - 1) * _border; // coordinate -> index
+			_voiExtent[i + 2 * j] = clamp(val, extent[2 * j], extent[2 * j + 1]); // prevent wrap around
 		}
 	}
-	voi->SetVOI(voiExt);
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage _img, const int _voiExtent[6]) const
+{
+	auto voi = vtkSmartPointer<vtkExtractVOI>::New();
+	voi->SetVOI(const_cast<int *>(_voiExtent));
 	voi->SetInputData(_img);
 	voi->Update();
 
@@ -232,7 +481,99 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage
 	}
 }
 
-MaterialMappingFilter::VtkImage MaterialMappingFilter::createStencil(const VtkUGrid _surMesh, const VtkImage _img) const
+namespace
+{
+	// point coordinates of the mesh as float or double array. Other types are converted once.
+	vtkSmartPointer<vtkDataArray> getPointCoordinates(vtkPointSet* _mesh)
+	{
+		vtkSmartPointer<vtkDataArray> coordinates = _mesh->GetPoints()->GetData();
+		if (coordinates->GetDataType() != VTK_FLOAT && coordinates->GetDataType() != VTK_DOUBLE)
+		{
+			auto converted = vtkSmartPointer<vtkDoubleArray>::New();
+			converted->DeepCopy(coordinates);
+			coordinates = converted;
+		}
+		return coordinates;
+	}
+
+	// corner point ids of all linear and quadratic tetras, 4 per tetra. Returns the number of other cells.
+	vtkIdType getTetraCorners(vtkUnstructuredGridBase* _mesh, std::vector<vtkIdType>& _corners)
+	{
+		auto numberOfCells = _mesh->GetNumberOfCells();
+		vtkIdType skipped = 0;
+		_corners.clear();
+		_corners.reserve(4 * numberOfCells);
+
+		auto grid = vtkUnstructuredGrid::SafeDownCast(_mesh);
+		auto pointIds = vtkSmartPointer<vtkIdList>::New();
+		for (vtkIdType i = 0; i < numberOfCells; ++i)
+		{
+			auto type = _mesh->GetCellType(i);
+			if (type != VTK_TETRA && type != VTK_QUADRATIC_TETRA)
+			{
+				++skipped;
+				continue;
+			}
+
+			// the corners come first in both node orders
+			if (grid != nullptr)
+			{
+				vtkIdType numberOfNodes;
+				vtkIdType* ids;
+				grid->GetCellPoints(i, numberOfNodes, ids);
+				_corners.insert(_corners.end(), ids, ids + 4);
+			}
+			else
+			{
+				_mesh->GetCellPoints(i, pointIds);
+				_corners.insert(_corners.end(), pointIds->GetPointer(0), pointIds->GetPointer(0) + 4);
+			}
+		}
+		return skipped;
+	}
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::createStencil(const VtkUGrid _volMesh, const VtkImage _img) const
+{
+	std::vector<vtkIdType> corners;
+	auto skipped = getTetraCorners(_volMesh, corners);
+	if (skipped > 0)
+	{
+		MITK_WARN("ch.zhaw.materialmapping") << skipped << " non-tetrahedral cells, the stencil is scan converted from the mesh surface instead.";
+		return createSurfaceStencil(_volMesh, _img);
+	}
+
+	auto stencil = vtkSmartPointer<vtkImageData>::New();
+	stencil->CopyStructure(_img);
+	stencil->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+	// world position of the first voxel of the VOI
+	int extent[6];
+	double origin[3], spacing[3];
+	_img->GetExtent(extent);
+	_img->GetOrigin(origin);
+	_img->GetSpacing(spacing);
+	for (auto i = 0; i < 3; ++i)
+	{
+		origin[i] += extent[2 * i] * spacing[i];
+	}
+
+	TetraVoxelizer voxelizer(origin, spacing, _img->GetDimensions());
+	auto mask = static_cast<unsigned char *>(stencil->GetScalarPointer());
+	auto coordinates = getPointCoordinates(_volMesh);
+	if (coordinates->GetDataType() == VTK_FLOAT)
+	{
+		voxelizer.voxelize(static_cast<const float *>(coordinates->GetVoidPointer(0)), corners.data(), corners.size() / 4, mask);
+	}
+	else
+	{
+		voxelizer.voxelize(static_cast<const double *>(coordinates->GetVoidPointer(0)), corners.data(), corners.size() / 4, mask);
+	}
+
+	return stencil;
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::createSurfaceStencil(const VtkUGrid _mesh, const VtkImage _img) const
 {
 	// configure
 	auto gridToPolyDataFilter = vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
@@ -245,17 +586,14 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::createStencil(const VtkUG
 	blankImage->CopyStructure(_img);
 	blankImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 	unsigned char* p = (unsigned char *) (blankImage->GetScalarPointer());
-	for (auto i = 0; i < blankImage->GetNumberOfPoints(); i++)
-	{
-		p[i] = 0;
-	}
+	std::fill(p, p + blankImage->GetNumberOfPoints(), 0);
 
 	auto stencil = vtkSmartPointer<vtkImageStencil>::New();
 	stencil->ReverseStencilOn();
 	stencil->SetBackgroundValue(1);
 
 	// pipeline
-	gridToPolyDataFilter->SetInputData(_surMesh);
+	gridToPolyDataFilter->SetInputData(_mesh);
 	polyDataToStencilFilter->SetInputConnection(gridToPolyDataFilter->GetOutputPort());
 	stencil->SetInputData(blankImage);
 	stencil->SetStencilConnection(polyDataToStencilFilter->GetOutputPort());
@@ -265,6 +603,11 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::createStencil(const VtkUG
 
 MaterialMappingFilter::VtkImage MaterialMappingFilter::createPeeledMask(const VtkImage _img, const VtkImage _mask)
 {
+	if (m_Method == Method::DistanceTransform)
+	{
+		return createPeeledMaskByDistance(_img, _mask);
+	}
+
 	// configure
 	auto erodeFilter = vtkSmartPointer<vtkImageContinuousErode3D>::New();
 	switch (m_Method)
@@ -276,6 +619,7 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::createPeeledMask(const Vt
 		}
 
 	case Method::New:
+	case Method::DistanceTransform: // handled above
 		{
 			erodeFilter->SetKernelSize(3, 3, 3);
 			break;
@@ -308,6 +652,7 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::createPeeledMask(const Vt
 		}
 
 	case Method::New:
+	case Method::DistanceTransform: // handled above
 		{
 			inplaceExtendImage(imgCopy, erodedMaskCopy, true);
 			break;
@@ -329,100 +674,129 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::createPeeledMask(const Vt
 	return erodeFilter->GetOutput();
 }
 
-void MaterialMappingFilter::inplaceExtendImage(VtkImage _img, VtkImage _mask, bool _maxval)
+MaterialMappingFilter::VtkImage MaterialMappingFilter::createPeeledMaskByDistance(const VtkImage _img, const VtkImage _mask) const
 {
 	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+	assert(_mask->GetScalarType() == VTK_UNSIGNED_CHAR && "Mask scalar type needs to be unsigned char!");
 
-	static const double kernel[27] = {
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1, 0, 1,
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3)
-	};
+	auto n = static_cast<std::ptrdiff_t>(_mask->GetNumberOfPoints());
+	auto mask = static_cast<const unsigned char *>(_mask->GetScalarPointer());
+	auto im = static_cast<const float *>(_img->GetScalarPointer());
 
-	auto math = vtkSmartPointer<vtkImageMathematics>::New();
-	auto imageconv = vtkSmartPointer<vtkImageConvolve>::New();
-	auto maskconv = vtkSmartPointer<vtkImageConvolve>::New();
-
-	// vtkImageMathematics needs both inputs to have the same scalar type
-	auto mask_float = vtkSmartPointer<vtkImageData>::New();
-	mask_float->CopyStructure(_mask);
-	mask_float->AllocateScalars(VTK_FLOAT, 1);
-	for (auto i = 0; i < mask_float->GetNumberOfPoints(); i++)
-	{
-		mask_float->GetPointData()->GetScalars()->SetTuple1(i, _mask->GetPointData()->GetScalars()->GetTuple1(i));
-	}
-
-	math->SetOperationToMultiply();
-	math->SetInput1Data(_img);
-	math->SetInput2Data(mask_float);
-	imageconv->SetKernel3x3x3(kernel);
-	imageconv->SetInputConnection(math->GetOutputPort());
-	imageconv->Update();
-	maskconv->SetKernel3x3x3(kernel);
-	maskconv->SetInputData(mask_float);
-	maskconv->Update();
-	auto maskPoints = (unsigned char *) (_mask->GetScalarPointer());
-	auto convMaskPoints = (float *) (maskconv->GetOutput()->GetScalarPointer());
-	auto convImgPoints = (float *) (imageconv->GetOutput()->GetScalarPointer());
-	auto imagePoints = (float *) (_img->GetScalarPointer());
+	auto peeled = vtkSmartPointer<vtkImageData>::New();
+	peeled->DeepCopy(_mask);
+	auto peeledMask = static_cast<unsigned char *>(peeled->GetScalarPointer());
 
-	for (auto i = 0; i < _img->GetNumberOfPoints(); i++)
-	{
-		if (convMaskPoints[i] && !maskPoints[i])
+	// core: the 26-neighborhood lies completely inside the mask, i.e. the squared distance to the nearest voxel outside
+	// is larger than 3. Same as the 3x3x3 erosion of the new method.
+	DistanceTransform toOutside;
+	toOutside.compute(mask, _mask->GetDimensions(), true);
+	parallelFor(n, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int)
+		{
+			for (auto i = _begin; i < _end; ++i)
+			{
+				peeledMask[i] = mask[i] && toOutside.getSquaredDistance(i) > 3;
+			}
+		});
+
+	// the shell keeps the voxels that are stiffer than the nearest core voxel
+	DistanceTransform toCore;
+	toCore.compute(peeledMask, _mask->GetDimensions());
+	parallelFor(n, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int)
 		{
-			auto val = convImgPoints[i] / convMaskPoints[i];
-			if (_maxval)
+			for (auto i = _begin; i < _end; ++i)
 			{
-				if (imagePoints[i] < val)
+				auto core = toCore.getNearestSite(i);
+				if (mask[i] && !peeledMask[i] && core >= 0 && im[i] > im[core])
 				{
-					imagePoints[i] = val;
+					peeledMask[i] = 1;
 				}
 			}
-			else
+		});
+
+	peeled->Modified();
+	return peeled;
+}
+
+void MaterialMappingFilter::inplaceExtendImageByDistance(VtkImage _img, VtkImage _mask, unsigned int _steps, bool _maxVal) const
+{
+	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+	assert(_mask->GetScalarType() == VTK_UNSIGNED_CHAR && "Mask scalar type needs to be unsigned char!");
+
+	auto n = static_cast<std::ptrdiff_t>(_mask->GetNumberOfPoints());
+	auto mask = static_cast<unsigned char *>(_mask->GetScalarPointer());
+	auto im = static_cast<float *>(_img->GetScalarPointer());
+
+	DistanceTransform toMask;
+	toMask.compute(mask, _mask->GetDimensions());
+
+	// the voxels reached by _steps 26-neighbor extend steps (Chebyshev distance), as with the other methods. A Euclidean
+	// reach of _steps would leave out the edge and corner neighbors.
+	std::vector<unsigned char> reach(n);
+	DistanceTransform::dilate(mask, _mask->GetDimensions(), _steps, reach.data());
+
+	// nearest sites are masked and therefore never written
+	parallelFor(n, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end, unsigned int)
+		{
+			for (auto i = _begin; i < _end; ++i)
 			{
-				imagePoints[i] = val;
+				if (!mask[i] && reach[i])
+				{
+					auto val = im[toMask.getNearestSite(i)];
+					if (!_maxVal || im[i] < val)
+					{
+						im[i] = val;
+					}
+					mask[i] = 1;
+				}
 			}
-			maskPoints[i] = 1;
-		}
-	}
+		});
+
+	_img->Modified();
+	_mask->Modified();
 }
 
-// uses some C code and unsafe function calls
-#include "lib/extendsurface3d.c"
+void MaterialMappingFilter::inplaceExtendImage(VtkImage _img, VtkImage _mask, bool _maxval)
+{
+	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+	assert(_mask->GetScalarType() == VTK_UNSIGNED_CHAR && "Mask scalar type needs to be unsigned char!");
+
+	ExtendImageKernel kernel(static_cast<float *>(_img->GetScalarPointer()), static_cast<unsigned char *>(_mask->GetScalarPointer()), _img->GetDimensions());
+	kernel.step(_maxval);
+	_img->Modified();
+	_mask->Modified();
+}
 
 void MaterialMappingFilter::inplaceExtendImageOld(VtkImage _img, VtkImage _mask, bool _maxval)
 {
 	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+	assert(_mask->GetScalarType() == VTK_UNSIGNED_CHAR && "Mask scalar type needs to be unsigned char!");
 
-	int* dim = _img->GetDimensions();
-	char* cx = (char *) malloc(dim[0] * dim[1] * dim[2] * sizeof(char));
-	float* ct_stack_ext_ptr = (float *) malloc(dim[0] * dim[1] * dim[2] * sizeof(float));
-
-	extendsurface(dim[1], dim[0], dim[2],
-	              (float *) (_img->GetScalarPointer()),
-	              (char *) (_mask->GetScalarPointer()), ct_stack_ext_ptr, cx);
-	float* ct_stack_ptr = (float *) (_img->GetScalarPointer());
-	unsigned char* c = (unsigned char *) (_mask->GetScalarPointer());
+	ExtendSurfaceKernel kernel;
+	kernel.extend(static_cast<float *>(_img->GetScalarPointer()), static_cast<unsigned char *>(_mask->GetScalarPointer()), _img->GetDimensions(), _maxval);
+	_img->Modified();
+	_mask->Modified();
+}
 
-	for (int i = 0; i < _mask->GetNumberOfPoints(); i++)
+namespace
+{
+	template<class TCoordinate>
+	void sampleNodes(const LinearImageSampler& _sampler, const TCoordinate* _coordinates, vtkIdType _n, double _minElem, double* _out, const std::atomic<bool>& _cancelled)
 	{
-		if (_maxval)
-		{
-			if (ct_stack_ptr[i] < ct_stack_ext_ptr[i])
-				ct_stack_ptr[i] = ct_stack_ext_ptr[i];
-		}
-		else
-			ct_stack_ptr[i] = ct_stack_ext_ptr[i];
-		c[i] = cx[i];
+		parallelFor(_n, [&](vtkIdType _begin, vtkIdType _end, unsigned int)
+			{
+				for (auto i = _begin; i < _end; ++i)
+				{
+					if ((i - _begin) % CancellationInterval == 0 && _cancelled.load(std::memory_order_relaxed))
+					{
+						return;
+					}
+					auto p = _coordinates + 3 * i;
+					auto val = _sampler(p[0], p[1], p[2]);
+					_out[i] = val > _minElem ? val : _minElem;
+				}
+			});
 	}
-	free(cx);
-	free(ct_stack_ext_ptr);
 }
 
 MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::interpolateToNodes(const VtkUGrid _mesh,
@@ -430,102 +804,465 @@ MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::interpolateToNodes(
                                                                                 std::string _name,
                                                                                 double _minElem) const
 {
+	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+
+	auto numberOfPoints = _mesh->GetNumberOfPoints();
 	auto data = vtkSmartPointer<vtkDoubleArray>::New();
 	data->SetNumberOfComponents(1);
 	data->SetName(_name.c_str());
+	data->SetNumberOfTuples(numberOfPoints);
+	if (numberOfPoints == 0)
+	{
+		return data;
+	}
 
-	auto interpolator = vtkSmartPointer<vtkImageInterpolator>::New();
-	interpolator->Initialize(_img);
-	interpolator->SetInterpolationModeToLinear();
-	interpolator->Update();
-
-	for (auto i = 0; i < _mesh->GetNumberOfPoints(); ++i)
+	auto coordinates = getPointCoordinates(_mesh);
+	LinearImageSampler sampler(_img);
+	auto out = data->GetPointer(0);
+	if (coordinates->GetDataType() == VTK_FLOAT)
 	{
-		auto p = _mesh->GetPoint(i);
-		auto val = interpolator->Interpolate(p[0], p[1], p[2], 0);
-		data->InsertTuple1(i, val > _minElem ? val : _minElem);
+		sampleNodes(sampler, static_cast<const float *>(coordinates->GetVoidPointer(0)), numberOfPoints, _minElem, out, m_Cancelled);
+	}
+	else
+	{
+		sampleNodes(sampler, static_cast<const double *>(coordinates->GetVoidPointer(0)), numberOfPoints, _minElem, out, m_Cancelled);
 	}
 
 	return data;
 }
 
-MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::nodesToElements(const VtkUGrid _mesh,
-                                                                             VtkDoubleArray _nodeData,
-                                                                             std::string _name) const
+namespace
 {
-	auto data = vtkSmartPointer<vtkDoubleArray>::New();
-	data->SetNumberOfComponents(1);
-	data->SetName(_name.c_str());
-
-	for (auto i = 0; i < _mesh->GetNumberOfCells(); ++i)
+	// cells with up to this many nodes are weighted without heap allocation
+	const vtkIdType MaximumNodesPerCell = 32;
+
+	/**
+	 * Inverse distance weighted average of the node values of one element: each node is weighted with the inverse of its
+	 * distance to the centroid, normalized so the node closest to the centroid has a weight of 1.0. TNodes > 0 fixes
+	 * the number of nodes at compile time.
+	 *
+	 * The arithmetic, including the incremental centroid, is kept exactly as in the former vtkCell based implementation,
+	 * so the element values do not change.
+	 */
+	template<int TNodes, class TCoordinate>
+	double weightElement(const TCoordinate* _coordinates, const vtkIdType* _pointIds, vtkIdType _numberOfNodes, const double* _nodeData, std::vector<double>& _scratch)
 	{
-		auto cellpoints = _mesh->GetCell(i)->GetPoints();
-		auto numberOfNodes = cellpoints->GetNumberOfPoints();
+		const vtkIdType numberOfNodes = TNodes > 0 ? TNodes : _numberOfNodes;
+		double buffer[TNodes > 0 ? TNodes : MaximumNodesPerCell];
+		double* distances = buffer;
+		if (TNodes <= 0 && numberOfNodes > MaximumNodesPerCell)
+		{
+			_scratch.resize(numberOfNodes);
+			distances = _scratch.data();
+		}
 
 		// get centroid
 		double centroid[3] = {0, 0, 0};
-		for (auto j = 0; j < numberOfNodes; ++j)
+		for (vtkIdType j = 0; j < numberOfNodes; ++j)
 		{
-			auto cellpoint = cellpoints->GetPoint(j);
+			auto cellpoint = _coordinates + 3 * _pointIds[j];
 			for (auto k = 0; k < 3; ++k)
 			{
-				centroid[k] = (centroid[k] * j + cellpoint[k]) / (j + 1);
+				centroid[k] = (centroid[k] * j + static_cast<double>(cellpoint[k])) / (j + 1);
 			}
 		}
 
-		// calculate nodal weight = squared distance to centroid
+		// calculate nodal weight = distance to centroid
 		double minDistance = std::numeric_limits<double>::max();
-		std::vector<double> squaredDistances(numberOfNodes);
-		for (auto j = 0; j < numberOfNodes; ++j)
+		for (vtkIdType j = 0; j < numberOfNodes; ++j)
 		{
-			auto cellpoint = cellpoints->GetPoint(j);
+			auto cellpoint = _coordinates + 3 * _pointIds[j];
 			double squaredDistance = 0;
 			for (auto k = 0; k < 3; ++k)
 			{
-				squaredDistance += pow(cellpoint[k] - centroid[k], 2);
+				auto d = static_cast<double>(cellpoint[k]) - centroid[k];
+				squaredDistance += d * d;
 			}
-			squaredDistance = sqrt(squaredDistance);
-			squaredDistances.at(j) = squaredDistance;
+			auto distance = std::sqrt(squaredDistance);
+			distances[j] = distance;
 
 			// if a node aligns with the centroid, we set it's weight to the next closest one
-			if (squaredDistance == 0)
-				squaredDistance = 1;
+			if (distance == 0)
+				distance = 1;
 
-			if (squaredDistance < minDistance)
-				minDistance = squaredDistance;
+			if (distance < minDistance)
+				minDistance = distance;
 		}
 
 		// invert weight and normalize
 		double value = 0, denom = 0;
-		for (auto j = 0; j < numberOfNodes; ++j)
+		for (vtkIdType j = 0; j < numberOfNodes; ++j)
 		{
-			// normalize the weight so the node closest to the centroid has a weight of 1.0
-			auto normalizedWeight = minDistance / squaredDistances.at(j);
+			auto normalizedWeight = minDistance / distances[j];
 			denom += normalizedWeight;
-			value += normalizedWeight * _nodeData->GetTuple1(_mesh->GetCell(i)->GetPointId(j));
+			value += normalizedWeight * _nodeData[_pointIds[j]];
+		}
+		return value / denom;
+	}
+
+	template<class TCoordinate>
+	void weightElements(vtkUnstructuredGrid* _mesh, const TCoordinate* _coordinates, const double* _nodeData, double* _out, const std::atomic<bool>& _cancelled)
+	{
+		// legacy connectivity layout: (n, id_0, ..., id_n-1) per cell
+		const vtkIdType* connectivity = _mesh->GetCells()->GetPointer();
+		const vtkIdType* locations = _mesh->GetCellLocationsArray()->GetPointer(0);
+		const unsigned char* types = _mesh->GetCellTypesArray()->GetPointer(0);
+
+		parallelFor(_mesh->GetNumberOfCells(), [&](vtkIdType _begin, vtkIdType _end, unsigned int)
+			{
+				std::vector<double> scratch;
+				for (auto i = _begin; i < _end; ++i)
+				{
+					if ((i - _begin) % CancellationInterval == 0 && _cancelled.load(std::memory_order_relaxed))
+					{
+						return;
+					}
+					auto cell = connectivity + locations[i];
+					auto numberOfNodes = cell[0];
+					auto pointIds = cell + 1;
+					if (types[i] == VTK_TETRA && numberOfNodes == 4)
+					{
+						_out[i] = weightElement<4>(_coordinates, pointIds, numberOfNodes, _nodeData, scratch);
+					}
+					else if (types[i] == VTK_QUADRATIC_TETRA && numberOfNodes == 10)
+					{
+						_out[i] = weightElement<10>(_coordinates, pointIds, numberOfNodes, _nodeData, scratch);
+					}
+					else
+					{
+						_out[i] = weightElement<0>(_coordinates, pointIds, numberOfNodes, _nodeData, scratch);
+					}
+				}
+			});
+	}
+}
+
+MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::nodesToElements(const VtkUGrid _mesh,
+                                                                             VtkDoubleArray _nodeData,
+                                                                             std::string _name) const
+{
+	auto numberOfCells = _mesh->GetNumberOfCells();
+	auto data = vtkSmartPointer<vtkDoubleArray>::New();
+	data->SetNumberOfComponents(1);
+	data->SetName(_name.c_str());
+	data->SetNumberOfTuples(numberOfCells);
+	if (numberOfCells == 0)
+	{
+		return data;
+	}
+
+	auto out = data->GetPointer(0);
+	auto nodeData = _nodeData->GetPointer(0);
+	auto coordinates = getPointCoordinates(_mesh);
+	auto grid = vtkUnstructuredGrid::SafeDownCast(_mesh);
+	if (grid != nullptr)
+	{
+		if (coordinates->GetDataType() == VTK_FLOAT)
+		{
+			weightElements(grid, static_cast<const float *>(coordinates->GetVoidPointer(0)), nodeData, out, m_Cancelled);
+		}
+		else
+		{
+			weightElements(grid, static_cast<const double *>(coordinates->GetVoidPointer(0)), nodeData, out, m_Cancelled);
 		}
-		auto weightedValue = value / denom;
-		data->InsertTuple1(i, weightedValue);
+		return data;
+	}
+
+	// other vtkUnstructuredGridBase implementations do not expose their connectivity. Serial, through vtkIdList.
+	auto pointIds = vtkSmartPointer<vtkIdList>::New();
+	auto doubleCoordinates = vtkSmartPointer<vtkDoubleArray>::New();
+	doubleCoordinates->DeepCopy(coordinates);
+	std::vector<double> scratch;
+	for (vtkIdType i = 0; i < numberOfCells; ++i)
+	{
+		_mesh->GetCellPoints(i, pointIds);
+		out[i] = weightElement<0>(doubleCoordinates->GetPointer(0), pointIds->GetPointer(0), pointIds->GetNumberOfIds(), nodeData, scratch);
 	}
 
 	return data;
 }
 
-void MaterialMappingFilter::inplaceApplyFunctorsToImage(MaterialMappingFilter::VtkImage _img)
+namespace
 {
-	for (auto i = 0; i < _img->GetNumberOfPoints(); i++)
+	// image sample clamped to the minimum element value, like the node values
+	struct ClampedSampler
+	{
+		const LinearImageSampler& sampler;
+		double minElem;
+
+		double operator()(double _x, double _y, double _z) const
+		{
+			auto val = sampler(_x, _y, _z);
+			return val > minElem ? val : minElem;
+		}
+	};
+
+	template<class TCoordinate>
+	void integrateElementsOf(vtkUnstructuredGrid* _mesh, const TCoordinate* _coordinates, const TetraQuadrature& _quadrature, const ClampedSampler& _sample, const double* _nodeData, double* _out, const std::atomic<bool>& _cancelled)
 	{
-		auto valCT = _img->GetPointData()->GetScalars()->GetTuple1(i);
-		auto valDensity = m_BoneDensityFunctor(valCT);
-		auto valEMorgan = m_PowerLawFunctor(std::max(valDensity, 0.0));
-		_img->GetPointData()->GetScalars()->SetTuple1(i, valEMorgan);
+		const vtkIdType* connectivity = _mesh->GetCells()->GetPointer();
+		const vtkIdType* locations = _mesh->GetCellLocationsArray()->GetPointer(0);
+		const unsigned char* types = _mesh->GetCellTypesArray()->GetPointer(0);
+
+		parallelFor(_mesh->GetNumberOfCells(), [&](vtkIdType _begin, vtkIdType _end, unsigned int)
+			{
+				std::vector<double> scratch;
+				for (auto i = _begin; i < _end; ++i)
+				{
+					if ((i - _begin) % CancellationInterval == 0 && _cancelled.load(std::memory_order_relaxed))
+					{
+						return;
+					}
+					auto cell = connectivity + locations[i];
+					auto numberOfNodes = cell[0];
+					auto pointIds = cell + 1;
+					if ((types[i] == VTK_TETRA && numberOfNodes == 4) || (types[i] == VTK_QUADRATIC_TETRA && numberOfNodes == 10))
+					{
+						_out[i] = _quadrature.average(_sample, _coordinates, pointIds, static_cast<int>(numberOfNodes));
+					}
+					else
+					{
+						_out[i] = weightElement<0>(_coordinates, pointIds, numberOfNodes, _nodeData, scratch);
+					}
+				}
+			});
 	}
 }
 
+MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::integrateElements(const VtkUGrid _mesh,
+                                                                               const VtkImage _img,
+                                                                               VtkDoubleArray _nodeData,
+                                                                               std::string _name,
+                                                                               double _minElem) const
+{
+	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+
+	auto grid = vtkUnstructuredGrid::SafeDownCast(_mesh);
+	if (grid == nullptr)
+	{
+		MITK_WARN("ch.zhaw.materialmapping") << "Element integration needs a vtkUnstructuredGrid. Averaging the node values instead.";
+		return nodesToElements(_mesh, _nodeData, _name);
+	}
+
+	auto numberOfCells = _mesh->GetNumberOfCells();
+	auto data = vtkSmartPointer<vtkDoubleArray>::New();
+	data->SetNumberOfComponents(1);
+	data->SetName(_name.c_str());
+	data->SetNumberOfTuples(numberOfCells);
+	if (numberOfCells == 0)
+	{
+		return data;
+	}
+
+	// the E image is the spatial index: every sample is a direct trilinear lookup
+	TetraQuadrature quadrature(m_ElementIntegrationOrder);
+	LinearImageSampler sampler(_img);
+	ClampedSampler sample = {sampler, _minElem};
+	auto out = data->GetPointer(0);
+	auto nodeData = _nodeData->GetPointer(0);
+	auto coordinates = getPointCoordinates(_mesh);
+	if (coordinates->GetDataType() == VTK_FLOAT)
+	{
+		integrateElementsOf(grid, static_cast<const float *>(coordinates->GetVoidPointer(0)), quadrature, sample, nodeData, out, m_Cancelled);
+	}
+	else
+	{
+		integrateElementsOf(grid, static_cast<const double *>(coordinates->GetVoidPointer(0)), quadrature, sample, nodeData, out, m_Cancelled);
+	}
+
+	return data;
+}
+
+namespace
+{
+	// tables beyond 16M entries (64MB) are not worth it, evaluate the kernel per voxel instead
+	const long long MaximumLookupTableSize = 1 << 24;
+
+	/**
+	 * Writes E for the voxels of _ct within _voiExtent into _e, which covers _voiExtent grown by _border in every
+	 * direction. The border is set to 0.
+	 *
+	 * Integer intensities are mapped through a HU->E lookup table over the occurring intensity range.
+	 */
+	template<class TPixel>
+	void computeElasticity(const ElasticityKernel& _kernel, vtkImageData* _ct, const int* _voiExtent, int _border, vtkImageData* _e, const std::atomic<bool>& _cancelled, TPixel*)
+	{
+		const auto nx = _voiExtent[1] - _voiExtent[0] + 1;
+		const auto ny = _voiExtent[3] - _voiExtent[2] + 1;
+		const auto nz = _voiExtent[5] - _voiExtent[4] + 1;
+		auto inputRow = [&](int _y, int _z)
+			{
+				return static_cast<const TPixel *>(_ct->GetScalarPointer(_voiExtent[0], _voiExtent[2] + _y, _voiExtent[4] + _z));
+			};
+
+		// occurring intensity range
+		std::vector<float> table;
+		long long tableMin = 0;
+		if (std::is_integral<TPixel>::value)
+		{
+			std::vector<TPixel> threadMin(parallelForNumberOfThreads(), std::numeric_limits<TPixel>::max());
+			std::vector<TPixel> threadMax(parallelForNumberOfThreads(), std::numeric_limits<TPixel>::lowest());
+			parallelFor(ny * nz, [&](int _begin, int _end, unsigned int _threadId)
+				{
+					for (auto row = _begin; row < _end; ++row)
+					{
+						auto in = inputRow(row % ny, row / ny);
+						auto minmax = std::minmax_element(in, in + nx);
+						threadMin[_threadId] = std::min(threadMin[_threadId], *minmax.first);
+						threadMax[_threadId] = std::max(threadMax[_threadId], *minmax.second);
+					}
+				});
+			auto min = *std::min_element(threadMin.begin(), threadMin.end());
+			auto max = *std::max_element(threadMax.begin(), threadMax.end());
+
+			if (static_cast<double>(max) - static_cast<double>(min) < MaximumLookupTableSize)
+			{
+				tableMin = static_cast<long long>(min);
+				table = _kernel.tabulate(tableMin, static_cast<long long>(max));
+			}
+		}
+
+		// one pass over the padded image, row by row
+		const auto paddedNy = ny + 2 * _border;
+		const auto paddedNz = nz + 2 * _border;
+		const auto paddedNx = nx + 2 * _border;
+		auto out = static_cast<float *>(_e->GetScalarPointer());
+		parallelFor(paddedNy * paddedNz, [&](int _begin, int _end, unsigned int)
+			{
+				for (auto row = _begin; row < _end; ++row)
+				{
+					if (_cancelled.load(std::memory_order_relaxed))
+					{
+						return;
+					}
+					auto y = row % paddedNy - _border;
+					auto z = row / paddedNy - _border;
+					auto outRow = out + static_cast<vtkIdType>(row) * paddedNx;
+					if (y < 0 || y >= ny || z < 0 || z >= nz)
+					{
+						std::fill(outRow, outRow + paddedNx, 0.0f);
+						continue;
+					}
+
+					std::fill(outRow, outRow + _border, 0.0f);
+					std::fill(outRow + _border + nx, outRow + paddedNx, 0.0f);
+					auto in = inputRow(y, z);
+					if (table.empty())
+					{
+						_kernel.apply(in, outRow + _border, nx);
+					}
+					else
+					{
+						for (auto x = 0; x < nx; ++x)
+						{
+							outRow[_border + x] = table[static_cast<long long>(in[x]) - tableMin];
+						}
+					}
+				}
+			});
+	}
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::createElasticityImage(const VtkImage _ct, const int _voiExtent[6], int _border) const
+{
+	int paddedExtent[6];
+	for (auto i = 0; i < 6; ++i)
+	{
+		paddedExtent[i] = _voiExtent[i] + _border * (2 * (i % 2) - 1);
+	}
+
+	auto eImage = vtkSmartPointer<vtkImageData>::New();
+	eImage->SetExtent(paddedExtent);
+	eImage->SetSpacing(_ct->GetSpacing());
+	eImage->SetOrigin(_ct->GetOrigin());
+	eImage->AllocateScalars(VTK_FLOAT, 1);
+
+	ElasticityKernel kernel(m_BoneDensityFunctor, m_PowerLawFunctor);
+	switch (_ct->GetScalarType())
+	{
+		vtkTemplateMacro(computeElasticity(kernel, _ct.GetPointer(), _voiExtent, _border, eImage.GetPointer(), m_Cancelled, static_cast<VTK_TT *>(nullptr)));
+	}
+	return eImage;
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::getElasticityImage(const VtkImage _ct, const int _voiExtent[6], int _border) const
+{
+	if (m_ElasticityImageCache == nullptr)
+	{
+		return createElasticityImage(_ct, _voiExtent, _border);
+	}
+
+	ElasticityImageCache::Key key;
+	key.image = m_IntensityImage.GetPointer();
+	key.modifiedTime = m_IntensityImage->GetMTime();
+	std::copy(_voiExtent, _voiExtent + 6, key.voiExtent);
+	key.border = _border;
+	key.densityFunctor = m_BoneDensityFunctor;
+	key.powerLawFunctor = m_PowerLawFunctor;
+
+	auto eImage = m_ElasticityImageCache->get(key);
+	if (eImage != nullptr)
+	{
+		MITK_INFO("ch.zhaw.materialmapping") << "E image from cache";
+		return eImage;
+	}
+
+	eImage = createElasticityImage(_ct, _voiExtent, _border);
+	if (!IsCancelled()) // incomplete otherwise
+	{
+		m_ElasticityImageCache->add(key, eImage);
+	}
+	return eImage;
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::cropElasticityImage(const VtkImage _e, const int _voiExtent[6], int _border) const
+{
+	assert(_e->GetScalarType() == VTK_FLOAT && "E image scalar type needs to be float!");
+
+	int paddedExtent[6], eExtent[6];
+	_e->GetExtent(eExtent);
+	for (auto i = 0; i < 6; ++i)
+	{
+		paddedExtent[i] = _voiExtent[i] + _border * (2 * (i % 2) - 1);
+		assert(i % 2 == 0 ? paddedExtent[i] >= eExtent[i] : paddedExtent[i] <= eExtent[i]);
+	}
+
+	auto eImage = vtkSmartPointer<vtkImageData>::New();
+	eImage->SetExtent(paddedExtent);
+	eImage->SetSpacing(_e->GetSpacing());
+	eImage->SetOrigin(_e->GetOrigin());
+	eImage->AllocateScalars(VTK_FLOAT, 1);
+
+	// same content as createElasticityImage for this VOI: E inside, 0 in the border
+	const auto nx = paddedExtent[1] - paddedExtent[0] + 1;
+	const auto ny = paddedExtent[3] - paddedExtent[2] + 1;
+	const auto nz = paddedExtent[5] - paddedExtent[4] + 1;
+	auto out = static_cast<float *>(eImage->GetScalarPointer());
+	parallelFor(ny * nz, [&](int _begin, int _end, unsigned int)
+		{
+			for (auto row = _begin; row < _end; ++row)
+			{
+				auto y = paddedExtent[2] + row % ny;
+				auto z = paddedExtent[4] + row / ny;
+				auto outRow = out + static_cast<vtkIdType>(row) * nx;
+				if (y < _voiExtent[2] || y > _voiExtent[3] || z < _voiExtent[4] || z > _voiExtent[5])
+				{
+					std::fill(outRow, outRow + nx, 0.0f);
+					continue;
+				}
+				auto in = static_cast<const float *>(_e->GetScalarPointer(_voiExtent[0], y, z));
+				std::fill(outRow, outRow + _border, 0.0f);
+				std::copy(in, in + (_voiExtent[1] - _voiExtent[0] + 1), outRow + _border);
+				std::fill(outRow + nx - _border, outRow + nx, 0.0f);
+			}
+		});
+	return eImage;
+}
+
 void MaterialMappingFilter::writeMetaImageToVerboseOut(const std::string _filename, vtkSmartPointer<vtkImageData> _img)
 {
-	vtkSmartPointer<vtkMetaImageWriter> writer = vtkSmartPointer<vtkMetaImageWriter>::New();
-	writer->SetFileName((m_VerboseOutputDirectory + "/" + _filename).c_str());
-	writer->SetInputData(_img);
-	writer->Write();
+	if (m_VerboseWriter)
+	{
+		m_VerboseWriter->write(_filename, _img);
+	}
 }
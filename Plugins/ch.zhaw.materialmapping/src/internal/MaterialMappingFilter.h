@@ -1,18 +1,27 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <mitkImage.h>
+#include <mitkUnstructuredGrid.h>
 #include <mitkUnstructuredGridToUnstructuredGridFilter.h>
 
 #include <vtkSmartPointer.h>
 #include <vtkImageData.h>
 #include <vtkUnstructuredGrid.h>
-#include <vtkImageStencil.h>
+#include <vtkDoubleArray.h>
 
 
 #include "BoneDensityFunctor.h"
+#include "ElasticityImageCache.h"
 #include "PowerLawFunctor.h"
+#include "VerboseImageWriter.h"
 
 /**
  * Given the input:
@@ -23,21 +32,29 @@
  * This filter outputs a material mapped mesh.
  *
  *  1. Creates a working copy of the CT image
- *  2. Casts the working copy value type to float
- *  3. Extracts a surface out of the unstructured grid (ugrid)
- *  4. Extracts a volume of interest (VOI) defined by the axis aligned bounding box of the surface + padding
- *  5. Evaluates the given functors for each voxel in the VOI
- *  6. Get a stencil from the surface
- *  7. (configurable) peel step.
- *  8. (configurable) image extends.
- *  9. Interpolate functor results to mesh nodes (=points)
- * 10. Calculate element (=cell) values by averaging surrounding node values.
- * 11. Add point and cell data (both named "E") to the output mesh.
- * 12. Return mesh
+ *  2. Extracts a surface out of the unstructured grid (ugrid)
+ *  3. Determines a volume of interest (VOI) defined by the axis aligned bounding box of the surface + padding
+ *  4. Evaluates the given functors for each voxel in the VOI, reading the CT in its native scalar type. The result is a
+ *     float image of the VOI, padded with 0 slices. Integer CTs are mapped through a HU->E lookup table over their
+ *     intensity range.
+ *  5. Get a stencil from the volume mesh: voxels whose center lies inside a tetra. Quadratic tetras count by their
+ *     corners. Meshes with any other cell type fall back to scan converting the mesh surface.
+ *  6. (configurable) peel step.
+ *  7. (configurable) image extends.
+ *  8. Interpolate functor results to mesh nodes (=points)
+ *  9. Calculate element (=cell) values by averaging surrounding node values, or optionally by integrating the E image
+ *     over each element.
+ * 10. Add point and cell data (both named "E") to the output mesh. The output shares points, cells and the input
+ *     arrays with the input mesh, so neither should be modified in place afterwards.
+ *     Optionally, 6. - 9. run a second time without peel step, sharing the results of 1. - 5.
+ * 11. Return mesh
  *
- * Note that 2 different mapping methods are available:
+ * Note that 3 different mapping methods are available:
  * - The "old" or current one. This is the approach discussed in the paper.
  * - A newer one containing some improvements for more accurate results that have yet to be verified.
+ * - An experimental one that replaces the iterated neighborhood operations of 6. and 7. by Euclidean distance
+ *   transforms: all extend steps at once, each extended voxel taking the value of the nearest masked voxel. The
+ *   extended voxels are the same as with the other methods, those within Chebyshev distance of the number of steps.
  *
  * The mapping is functionally equivalent to assignElasticModulus.cc 26.11.15 (v3).
  */
@@ -47,7 +64,8 @@ public:
 	enum class Method
 	{
 		Old, // as originally published
-		New // modified and improved
+		New, // modified and improved
+		DistanceTransform // peel and extend by Euclidean distance, experimental
 	};
 
 	mitkClassMacro(MaterialMappingFilter, UnstructuredGridToUnstructuredGridFilter)
@@ -91,12 +109,47 @@ public:
 		m_MinimumElementValue = _f;
 	}
 
+	/**
+	 * Element values by integrating E over each tetra with _order^3 Gauss points, instead of averaging the node values.
+	 * Non-tetrahedral cells keep the node average. 0 (default) disables the integration.
+	 */
+	void SetElementIntegrationOrder(unsigned int _order)
+	{
+		m_ElementIntegrationOrder = _order;
+	}
+
+	/**
+	 * Writes the intermediate images as MetaImages to the given directory. They are written on a background thread
+	 * while the mapping continues, the update waits for the remaining ones at the end.
+	 */
 	void SetIntermediateResultOutputDirectory(std::string _d)
 	{
 		m_VerboseOutput = true;
 		m_VerboseOutputDirectory = _d;
 	}
 
+	void SetIntermediateResultCompression(bool _b)
+	{
+		m_VerboseOutputCompression = _b;
+	}
+
+	/**
+	 * Only writes every _i-th voxel along each axis of the intermediate images. 1 (default) writes all voxels.
+	 */
+	void SetIntermediateResultDecimation(unsigned int _i)
+	{
+		m_VerboseOutputDecimation = _i;
+	}
+
+	/**
+	 * Only writes the part of the intermediate images inside the given extent, in voxels of the intensity image.
+	 */
+	void SetIntermediateResultRegionOfInterest(const int _extent[6])
+	{
+		m_HasVerboseOutputRegionOfInterest = true;
+		std::copy(_extent, _extent + 6, m_VerboseOutputRegionOfInterest);
+	}
+
     void SetPointArrayName(std::string _s)
     {
         m_PointArrayName = _s;
@@ -107,11 +160,76 @@ public:
         m_CellArrayName = _s;
     }
 
+	/**
+	 * Additionally maps the mesh without the peel step into the given arrays. All stages up to the stencil are shared
+	 * with the peeled mapping, only the peel and extend steps run a second time, in parallel. Has no effect if the peel
+	 * step is disabled. Empty names (default) disable the unpeeled output.
+	 */
+	void SetUnpeeledPointArrayName(std::string _s)
+	{
+		m_UnpeeledPointArrayName = _s;
+	}
+
+	void SetUnpeeledCellArrayName(std::string _s)
+	{
+		m_UnpeeledCellArrayName = _s;
+	}
+
+	/**
+	 * Computes the E image once for several meshes: it covers the union of their VOIs and is padded like the VOI of a
+	 * single mesh. Uses the intensity image, functors and number of extend steps of this filter.
+	 */
+	vtkSmartPointer<vtkImageData> CreateElasticityImage(const std::vector<mitk::UnstructuredGrid::Pointer>& _meshes);
+
+	/**
+	 * E image from CreateElasticityImage of a filter with the same intensity image, functors and number of extend steps.
+	 * The filter crops its VOI from it instead of evaluating the functors. It is only read, so multiple filters can share
+	 * it and run concurrently. nullptr (default) computes the E image from the intensity image.
+	 */
+	void SetElasticityImage(vtkSmartPointer<vtkImageData> _e)
+	{
+		m_ElasticityImage = _e;
+	}
+
+	/**
+	 * Looks up the E image of the VOI in the cache before evaluating the functors, and stores it afterwards. The cache
+	 * can be shared by any number of filters. nullptr (default) disables caching.
+	 */
+	void SetElasticityImageCache(std::shared_ptr<ElasticityImageCache> _cache)
+	{
+		m_ElasticityImageCache = _cache;
+	}
+
+	/**
+	 * Called after each stage with its name, the number of processed items (voxels, nodes or elements) and its duration
+	 * in seconds. The extend steps of the unpeeled branch run on a separate thread and report from there.
+	 */
+	using StageCallback = std::function<void(const std::string& _stage, std::size_t _items, double _seconds)>;
+
+	void SetStageCallback(StageCallback _c)
+	{
+		m_StageCallback = _c;
+	}
+
+	/**
+	 * Thread safe. The running update stops at the next stage boundary, the parallel loops stop early. GenerateData
+	 * then throws itk::ProcessAborted. Every update starts uncancelled, so a cancel without a running update has no
+	 * effect, see MaterialMappingJob for cancelling before the update.
+	 */
+	void Cancel()
+	{
+		m_Cancelled = true;
+	}
+
+	bool IsCancelled() const
+	{
+		return m_Cancelled;
+	}
+
 	virtual void GenerateData() override;
 
 protected:
 	using VtkImage = vtkSmartPointer<vtkImageData>;
-	using VtkStencil = vtkSmartPointer<vtkImageStencil>;
 	using VtkUGrid = vtkSmartPointer<vtkUnstructuredGridBase>;
 	using VtkDoubleArray = vtkSmartPointer<vtkDoubleArray>;
 
@@ -121,26 +239,52 @@ protected:
 	{
 	};
 
+	VtkImage getIntensityVtkImage() const; // the intensity image with corrected origin
 	VtkUGrid extractSurface(const VtkUGrid) const;
-	VtkImage extractVOI(const VtkImage, const VtkUGrid) const;
-	VtkImage createStencil(const VtkUGrid, const VtkImage) const;
+	void computeVOIExtent(const VtkImage, const VtkUGrid, int _border, int _voiExtent[6]) const; // bounding box of the surface + border, clamped to the image
+	VtkImage extractVOI(const VtkImage, const int _voiExtent[6]) const;
+	VtkImage createStencil(const VtkUGrid _volMesh, const VtkImage) const; // voxelizes the tetras of the volume mesh
+	VtkImage createSurfaceStencil(const VtkUGrid _mesh, const VtkImage) const; // scan converts the mesh surface, for meshes with other cells than tetras
 	VtkImage createPeeledMask(const VtkImage _img, const VtkImage _mask);
+	VtkImage createPeeledMaskByDistance(const VtkImage _img, const VtkImage _mask) const;
 	void inplaceExtendImage(VtkImage _img, VtkImage _mask, bool _maxVal); // weighted average in neighborhood, performed in place
 	void inplaceExtendImageOld(VtkImage _img, VtkImage _mask, bool _maxVal);
-	void inplaceApplyFunctorsToImage(VtkImage _img);
+	void inplaceExtendImageByDistance(VtkImage _img, VtkImage _mask, unsigned int _steps, bool _maxVal) const; // nearest masked value up to a distance of _steps voxels, performed in place
+	void inplaceExtendImageSteps(VtkImage _img, VtkImage _mask, const std::string _verbosePrefix, const std::string _stagePrefix); // all extend steps of the configured method
+	VtkImage createElasticityImage(const VtkImage _ct, const int _voiExtent[6], int _border) const; // float E image of the VOI, padded with _border 0 slices
+	VtkImage getElasticityImage(const VtkImage _ct, const int _voiExtent[6], int _border) const; // createElasticityImage through the cache
+	VtkImage cropElasticityImage(const VtkImage _e, const int _voiExtent[6], int _border) const; // same, copied from a precomputed E image
 	VtkDoubleArray interpolateToNodes(const VtkUGrid, const VtkImage, std::string _name, double _minElem) const; // "interpolateToNodes". evaluates both functors for each vertex of the mesh
 	VtkDoubleArray nodesToElements(const VtkUGrid, VtkDoubleArray _nodeData, std::string _name) const;
+	VtkDoubleArray integrateElements(const VtkUGrid, const VtkImage, VtkDoubleArray _nodeData, std::string _name, double _minElem) const; // volume average of E per tetra
+	void addNodeAndElementData(vtkUnstructuredGrid* _out, const VtkUGrid _mesh, const VtkImage _img, const std::string _pointArrayName, const std::string _cellArrayName, const std::string _stagePrefix);
+	void finishStage(const std::string _stage, std::size_t _items, std::chrono::steady_clock::time_point& _start) const; // reports the stage to the callback and restarts the clock
+	void progress(unsigned int _steps = 1); // mitk::ProgressBar, counts down m_RemainingProgressSteps
+	void throwIfCancelled(); // itk::ProcessAborted
 
 	mitk::Image::Pointer m_IntensityImage;
+	VtkImage m_ElasticityImage;
+	std::shared_ptr<ElasticityImageCache> m_ElasticityImageCache;
+	StageCallback m_StageCallback;
+	std::atomic<bool> m_Cancelled{false};
+	unsigned int m_RemainingProgressSteps = 0; // of the running update, reported at its end also if it throws
 	BoneDensityFunctor m_BoneDensityFunctor;
 	PowerLawFunctor m_PowerLawFunctor;
-	bool m_DoPeelStep = true, m_VerboseOutput;
+	bool m_DoPeelStep = true, m_VerboseOutput = false;
 	std::string m_VerboseOutputDirectory;
+	bool m_VerboseOutputCompression = false;
+	unsigned int m_VerboseOutputDecimation = 1;
+	bool m_HasVerboseOutputRegionOfInterest = false;
+	int m_VerboseOutputRegionOfInterest[6];
+	std::unique_ptr<VerboseImageWriter> m_VerboseWriter; // only during an update
     std::string m_PointArrayName;
     std::string m_CellArrayName;
+	std::string m_UnpeeledPointArrayName;
+	std::string m_UnpeeledCellArrayName;
 	float m_MinimumElementValue = 0.0;
 	unsigned int m_NumberOfExtendImageSteps = 3;
+	unsigned int m_ElementIntegrationOrder = 0;
 	Method m_Method;
 
-	void writeMetaImageToVerboseOut(const std::string filename, vtkSmartPointer<vtkImageData> image);
+	void writeMetaImageToVerboseOut(const std::string filename, vtkSmartPointer<vtkImageData> image); // queued, thread safe
 };
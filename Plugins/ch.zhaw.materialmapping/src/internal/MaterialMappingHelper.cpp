@@ -1,5 +1,7 @@
 #include "MaterialMappingHelper.h"
 
+#include <memory>
+
 #include <vtkCellData.h>
 #include <vtkDoubleArray.h>
 #include <vtkPointData.h>
@@ -10,6 +12,57 @@
 
 namespace MaterialMappingHelper
 {
+    /*
+     * Array named _name that uses the memory of _source. The alias does not own the memory, it is only valid as long as
+     * _source is. Copying the mesh (DeepCopy, writers) turns it into an independent array.
+     */
+    static vtkSmartPointer<vtkDoubleArray> createAlias(vtkDataArray *_source, const char *_name)
+    {
+        auto source = vtkDoubleArray::SafeDownCast(_source);
+        if (source == nullptr)
+        {
+            return nullptr;
+        }
+        auto alias = vtkSmartPointer<vtkDoubleArray>::New();
+        alias->SetNumberOfComponents(source->GetNumberOfComponents());
+        alias->SetArray(source->GetPointer(0), source->GetNumberOfValues(), 1);
+        alias->SetName(_name);
+        return alias;
+    }
+
+    static MaterialMappingFilter::Pointer createFilter(mitk::Image::Pointer spIntensityImage,
+                                                       MaterialMappingFilter::Method eMethod,
+                                                       const BoneDensityFunctor &densityFunctor,
+                                                       const PowerLawFunctor &powerLawFunctor,
+                                                       float fMinE,
+                                                       std::shared_ptr<ElasticityImageCache> cache)
+    {
+        auto filter = MaterialMappingFilter::New();
+        filter->SetElasticityImageCache(cache);
+
+        // B & C peeled, A unpeeled. One run, the common stages are computed once.
+        filter->SetIntensityImage(spIntensityImage);
+        filter->SetMethod(eMethod);
+        filter->SetDensityFunctor(BoneDensityFunctor(densityFunctor));
+        filter->SetPowerLawFunctor(PowerLawFunctor(powerLawFunctor));
+        filter->SetDoPeelStep(true);
+        filter->SetNumberOfExtendImageSteps(3);
+        filter->SetMinElementValue(fMinE);
+        filter->SetPointArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C);
+        filter->SetCellArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B);
+        filter->SetUnpeeledCellArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A);
+        return filter;
+    }
+
+    // D and E share the memory of C and A
+    static void addAliases(mitk::UnstructuredGrid::Pointer spMeshResult)
+    {
+        auto pointData = spMeshResult->GetVtkUnstructuredGrid()->GetPointData();
+        auto cellData = spMeshResult->GetVtkUnstructuredGrid()->GetCellData();
+        pointData->AddArray(createAlias(pointData->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C), GEM_DATA_ARRAY_NAME_MATMAP_METHOD_D));
+        cellData->AddArray(createAlias(cellData->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A), GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E));
+    }
+
     /*
      * Runs the material mapping on the given input for all methods
      * Method A: 0 erosion steps, 3 dilation steps (output element E-values)
@@ -17,52 +70,91 @@ namespace MaterialMappingHelper
      * Method C: 1 erosion step, 3 dilation steps (output nodal E-values)
      * Method D: 1 erosion step, 3 dilation steps (output nodal E-values). Same output as in C
      * Method E: 0 erosion steps, 3 dilation steps (output element E-values). Same output as in A
+     *
+     * Re-runs with the same CT and calibration reuse the E image from the optional cache, the caller decides about its
+     * lifetime and memory limit. nullptr computes the E image every time. The optional observer is called after each
+     * stage of the filter, see MaterialMappingJob.
      */
     mitk::UnstructuredGrid::Pointer Compute(mitk::UnstructuredGrid::Pointer spMesh,
                                             mitk::Image::Pointer spIntensityImage,
                                             MaterialMappingFilter::Method eMethod,
                                             BoneDensityFunctor densityFunctor,
                                             PowerLawFunctor powerLawFunctor,
-                                            float fMinE)
+                                            float fMinE,
+                                            std::shared_ptr<ElasticityImageCache> cache,
+                                            MaterialMappingJob::Observer observer)
     {
-        auto filter = MaterialMappingFilter::New();
+        auto job = CreateJob(spMesh, spIntensityImage, eMethod, densityFunctor, powerLawFunctor, fMinE, cache);
+        job->setObserver(observer);
+        job->run();
+        return GetResult(*job);
+    }
 
-        // B & C
+    /*
+     * Job of Compute that has not run yet, for callers that run it on a worker thread and cancel it. The result of a
+     * completed run is available through GetResult.
+     */
+    std::shared_ptr<MaterialMappingJob> CreateJob(mitk::UnstructuredGrid::Pointer spMesh,
+                                                  mitk::Image::Pointer spIntensityImage,
+                                                  MaterialMappingFilter::Method eMethod,
+                                                  BoneDensityFunctor densityFunctor,
+                                                  PowerLawFunctor powerLawFunctor,
+                                                  float fMinE,
+                                                  std::shared_ptr<ElasticityImageCache> cache)
+    {
+        auto filter = createFilter(spIntensityImage, eMethod, densityFunctor, powerLawFunctor, fMinE, cache);
         filter->SetInput(spMesh);
-        filter->SetIntensityImage(spIntensityImage);
-        filter->SetMethod(eMethod);
-        filter->SetDensityFunctor(std::move(densityFunctor));
-        filter->SetPowerLawFunctor(std::move(powerLawFunctor));
-        filter->SetDoPeelStep(true);
-        filter->SetNumberOfExtendImageSteps(3);
-        filter->SetMinElementValue(fMinE);
-        filter->SetPointArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C);
-        filter->SetCellArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B);
-        auto spMeshBC = filter->GetOutput();
-        filter->Update();
+        return std::make_shared<MaterialMappingJob>(filter);
+    }
 
-        // A
-        filter->SetInput(spMeshBC);
-        filter->SetDoPeelStep(false);
-        filter->SetPointArrayName("");
-        filter->SetCellArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A);
-        auto spMeshResult = filter->GetOutput();
-        filter->Update();
+    // the mapped mesh of a job from CreateJob, with all methods A-E
+    mitk::UnstructuredGrid::Pointer GetResult(const MaterialMappingJob &job)
+    {
+        auto spMeshResult = job.getFilter()->GetOutput();
+        addAliases(spMeshResult);
+        return spMeshResult;
+    }
 
-        // Copy D
-        auto dataD = vtkSmartPointer<vtkDoubleArray>::New();
-        dataD->SetNumberOfComponents(1);
-        dataD->DeepCopy(spMeshResult->GetVtkUnstructuredGrid()->GetPointData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C));
-        dataD->SetName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_D);
-        spMeshResult->GetVtkUnstructuredGrid()->GetPointData()->AddArray(dataD);
+    /*
+     * Same as Compute for several meshes on one image. The E image is computed once over the union of the mesh VOIs,
+     * then the meshes are mapped one after the other from it.
+     */
+    std::vector<mitk::UnstructuredGrid::Pointer> ComputeBatch(const std::vector<mitk::UnstructuredGrid::Pointer> &meshes,
+                                                              mitk::Image::Pointer spIntensityImage,
+                                                              MaterialMappingFilter::Method eMethod,
+                                                              BoneDensityFunctor densityFunctor,
+                                                              PowerLawFunctor powerLawFunctor,
+                                                              float fMinE,
+                                                              std::shared_ptr<ElasticityImageCache> cache)
+    {
+        std::vector<MaterialMappingFilter::Pointer> filters;
+        std::vector<mitk::UnstructuredGrid::Pointer> results;
+        for (const auto &spMesh : meshes)
+        {
+            auto filter = createFilter(spIntensityImage, eMethod, densityFunctor, powerLawFunctor, fMinE, cache);
+            filter->SetInput(spMesh);
+            filters.push_back(filter);
+            results.push_back(filter->GetOutput());
+        }
+        if (filters.empty())
+        {
+            return results;
+        }
 
-        // Copy E
-        auto dataE = vtkSmartPointer<vtkDoubleArray>::New();
-        dataE->SetNumberOfComponents(1);
-        dataE->DeepCopy(spMeshResult->GetVtkUnstructuredGrid()->GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A));
-        dataE->SetName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E);
-        spMeshResult->GetVtkUnstructuredGrid()->GetCellData()->AddArray(dataE);
+        // one after the other: every filter already uses all cores in its parallel loops and for the unpeeled branch,
+        // mapping the meshes concurrently on top of that only oversubscribes the machine. Exceptions propagate as in
+        // Compute.
+        auto eImage = filters.front()->CreateElasticityImage(meshes);
+        for (auto &filter : filters)
+        {
+            filter->SetElasticityImage(eImage);
+            filter->Update();
+        }
 
-        return spMeshResult;
+        for (auto &spMeshResult : results)
+        {
+            addAliases(spMeshResult);
+        }
+        return results;
     }
 }
\ No newline at end of file
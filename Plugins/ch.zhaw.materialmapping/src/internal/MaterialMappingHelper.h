@@ -1,8 +1,13 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <mitkImage.h>
 #include <mitkUnstructuredGrid.h>
+#include "ElasticityImageCache.h"
 #include "MaterialMappingFilter.h"
+#include "MaterialMappingJob.h"
 
 namespace MaterialMappingHelper
 {
@@ -11,5 +16,25 @@ namespace MaterialMappingHelper
                                             MaterialMappingFilter::Method eMethod,
                                             BoneDensityFunctor densityFunctor,
                                             PowerLawFunctor powerLawFunctor,
-                                            float fMinE);
+                                            float fMinE,
+                                            std::shared_ptr<ElasticityImageCache> cache = nullptr,
+                                            MaterialMappingJob::Observer observer = nullptr);
+
+    std::shared_ptr<MaterialMappingJob> CreateJob(mitk::UnstructuredGrid::Pointer spMesh,
+                                                  mitk::Image::Pointer spIntensityImage,
+                                                  MaterialMappingFilter::Method eMethod,
+                                                  BoneDensityFunctor densityFunctor,
+                                                  PowerLawFunctor powerLawFunctor,
+                                                  float fMinE,
+                                                  std::shared_ptr<ElasticityImageCache> cache = nullptr);
+
+    mitk::UnstructuredGrid::Pointer GetResult(const MaterialMappingJob &job);
+
+    std::vector<mitk::UnstructuredGrid::Pointer> ComputeBatch(const std::vector<mitk::UnstructuredGrid::Pointer> &meshes,
+                                                              mitk::Image::Pointer spIntensityImage,
+                                                              MaterialMappingFilter::Method eMethod,
+                                                              BoneDensityFunctor densityFunctor,
+                                                              PowerLawFunctor powerLawFunctor,
+                                                              float fMinE,
+                                                              std::shared_ptr<ElasticityImageCache> cache = nullptr);
 }
\ No newline at end of file
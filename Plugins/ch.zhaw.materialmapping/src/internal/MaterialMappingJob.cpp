@@ -0,0 +1,76 @@
+#include <itkExceptionObject.h>
+
+#include "MaterialMappingJob.h"
+
+MaterialMappingJob::MaterialMappingJob(MaterialMappingFilter::Pointer _filter)
+        : m_Filter(_filter)
+        , m_Cancelled(false)
+        , m_RunCancelled(false) {
+}
+
+void MaterialMappingJob::setObserver(Observer _observer) {
+    m_Observer = _observer;
+}
+
+bool MaterialMappingJob::run() {
+    m_RunCancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stages.clear();
+    }
+
+    // a cancel before the run applies to this run, the filter itself forgets cancels outside of an update
+    auto completed = false;
+    if (!m_Cancelled.exchange(false)) {
+        m_Filter->SetStageCallback([this](const std::string &_stage, std::size_t _items, double _seconds) {
+            Stage stage = {_stage, _items, _seconds};
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stages.push_back(stage);
+            }
+            if (m_Observer) {
+                m_Observer(stage);
+            }
+        });
+
+        try {
+            m_Filter->Update();
+            completed = true;
+        } catch (const itk::ProcessAborted &) {
+            completed = false;
+        }
+
+        m_Filter->SetStageCallback(nullptr);
+    }
+
+    // a cancel during the run is consumed here, so the job can be run again
+    m_RunCancelled = m_Cancelled.exchange(false) || !completed;
+    return !m_RunCancelled;
+}
+
+void MaterialMappingJob::cancel() {
+    m_Cancelled = true;
+    m_Filter->Cancel();
+}
+
+bool MaterialMappingJob::isCancelled() const {
+    return m_Cancelled || m_RunCancelled;
+}
+
+MaterialMappingFilter::Pointer MaterialMappingJob::getFilter() const {
+    return m_Filter;
+}
+
+std::vector<MaterialMappingJob::Stage> MaterialMappingJob::getStages() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stages;
+}
+
+double MaterialMappingJob::getSeconds() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    double seconds = 0;
+    for (const auto &stage : m_Stages) {
+        seconds += stage.seconds;
+    }
+    return seconds;
+}
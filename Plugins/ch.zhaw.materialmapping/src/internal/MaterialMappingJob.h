@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MaterialMappingFilter.h"
+
+/**
+ * Runs a configured MaterialMappingFilter and records duration and throughput of each of its stages (VOI, E image,
+ * stencil, peel, every extend step, nodes, elements).
+ *
+ * The job can be cancelled from any thread, also before it runs. Does not depend on Qt, so it serves the view as well
+ * as headless tools.
+ */
+class MaterialMappingJob {
+public:
+    struct Stage {
+        std::string name;
+        std::size_t items; // voxels, nodes or elements
+        double seconds;
+
+        double getThroughput() const {
+            return seconds > 0 ? items / seconds : 0;
+        }
+    };
+
+    /**
+     * Called after each stage. Might be called from a worker thread, see MaterialMappingFilter::SetStageCallback.
+     */
+    using Observer = std::function<void(const Stage &)>;
+
+    explicit MaterialMappingJob(MaterialMappingFilter::Pointer _filter);
+
+    void setObserver(Observer _observer);
+
+    /**
+     * Updates the filter. Returns false if the job was cancelled before or during the run, the output is incomplete
+     * in this case. Each run consumes the cancel, so the job can be run again.
+     */
+    bool run();
+
+    void cancel();
+
+    /**
+     * True if a cancel is pending or the last run was cancelled.
+     */
+    bool isCancelled() const;
+
+    MaterialMappingFilter::Pointer getFilter() const;
+    std::vector<Stage> getStages() const;
+    double getSeconds() const; // sum over all stages
+
+private:
+    MaterialMappingFilter::Pointer m_Filter;
+    Observer m_Observer;
+    std::vector<Stage> m_Stages;
+    mutable std::mutex m_Mutex;
+    std::atomic<bool> m_Cancelled; // pending, until the next run ends
+    std::atomic<bool> m_RunCancelled;
+};
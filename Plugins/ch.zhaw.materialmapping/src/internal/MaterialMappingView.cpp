@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include <berryISelectionService.h>
 #include <berryIWorkbenchWindow.h>
@@ -92,6 +93,9 @@ void MaterialMappingView::CreateQtPartControl(QWidget *parent) {
 
     // signals
     connect(m_Controls.startButton, SIGNAL(clicked()), this, SLOT(startButtonClicked()));
+    connect(m_Controls.cancelButton, SIGNAL(clicked()), this, SLOT(cancelButtonClicked()));
+    connect(this, SIGNAL(stageFinished(QString)), this, SLOT(showStage(QString)), Qt::QueuedConnection);
+    connect(this, SIGNAL(jobFinished(bool)), this, SLOT(addResult(bool)), Qt::QueuedConnection);
     connect(m_Controls.saveParametersButton, SIGNAL(clicked()), this, SLOT(saveParametersButtonClicked()));
     connect(m_Controls.loadParametersButton, SIGNAL(clicked()), this, SLOT(loadParametersButtonClicked()));
     connect(&m_CalibrationDataModel, SIGNAL(dataChanged()), this, SLOT(tableDataChanged()));
@@ -133,45 +137,71 @@ void MaterialMappingView::startButtonClicked() {
         mitk::Image::Pointer image = dynamic_cast<mitk::Image *>(imageNode->GetData());
         mitk::UnstructuredGrid::Pointer ugrid = dynamic_cast<mitk::UnstructuredGrid *>(ugridNode->GetData());
 
-        auto work = [this, image, ugrid]() {
-            m_Controls.scrollArea->setEnabled(false);
-
-//            auto filter = MaterialMappingFilter::New();
-//            filter->SetInput(ugrid);
-//            filter->SetMethod(gui::getSelectedMappingMethod(m_Controls));
-//            filter->SetIntensityImage(image);
-//            filter->SetDensityFunctor(gui::createDensityFunctor(m_Controls, m_CalibrationDataModel));
-//            filter->SetPowerLawFunctor(m_PowerLawWidgetManager->createFunctor());
-//            filter->SetDoPeelStep(m_Controls.uParamCheckBox->isChecked());
-//            filter->SetNumberOfExtendImageSteps(m_Controls.eParamSpinBox->value());
-//            filter->SetMinElementValue(m_Controls.fParamSpinBox->value());
-//            auto result = filter->GetOutput();
-//            filter->Update();
-
-            auto result = MaterialMappingHelper::Compute(ugrid,
-                                                         image,
-                                                         gui::getSelectedMappingMethod(m_Controls),
-                                                         gui::createDensityFunctor(m_Controls, m_CalibrationDataModel),
-                                                         m_PowerLawWidgetManager->createFunctor(),
-                                                         m_Controls.fParamSpinBox->value());
-
-            mitk::DataNode::Pointer newNode = mitk::DataNode::New();
-            newNode->SetData(result);
-
-            // set some node properties
-            newNode->SetProperty("name", mitk::StringProperty::New("material mapped mesh"));
-            newNode->SetProperty("layer", mitk::IntProperty::New(1));
-
-            // add result to the storage
-            this->GetDataStorage()->Add(newNode);
-
-            m_Controls.scrollArea->setEnabled(true);
+        auto job = MaterialMappingHelper::CreateJob(ugrid,
+                                                    image,
+                                                    gui::getSelectedMappingMethod(m_Controls),
+                                                    gui::createDensityFunctor(m_Controls, m_CalibrationDataModel),
+                                                    m_PowerLawWidgetManager->createFunctor(),
+                                                    m_Controls.fParamSpinBox->value(),
+                                                    m_ElasticityImageCache);
+        job->setObserver([this](const MaterialMappingJob::Stage &_stage) {
+            auto name = QString::fromStdString(_stage.name);
+            emit stageFinished(QString("%1 done (%2 s)").arg(name).arg(_stage.seconds, 0, 'f', 2));
+        });
+        m_Job = job;
+
+        m_Controls.scrollArea->setEnabled(false);
+        m_Controls.cancelButton->setEnabled(true);
+        m_Controls.stageLabel->setText("");
+
+        // the filter reports its stages to the progress bar itself
+        auto work = [this, job]() {
+            auto completed = false;
+            try {
+                completed = job->run();
+            } catch (const std::exception &e) {
+                MITK_ERROR("ch.zhaw.materialmapping") << "material mapping failed: " << e.what();
+            }
+            emit jobFinished(completed);
         };
 
         m_WorkerFuture = QtConcurrent::run(static_cast<std::function<void()>>(work));
     }
 }
 
+void MaterialMappingView::cancelButtonClicked() {
+    if (m_Job) {
+        MITK_INFO("ch.zhaw.materialmapping") << "cancelling";
+        m_Job->cancel();
+        m_Controls.cancelButton->setEnabled(false);
+    }
+}
+
+void MaterialMappingView::showStage(QString _stage) {
+    m_Controls.stageLabel->setText(_stage);
+}
+
+void MaterialMappingView::addResult(bool _completed) {
+    if (_completed && m_Job) {
+        mitk::DataNode::Pointer newNode = mitk::DataNode::New();
+        newNode->SetData(MaterialMappingHelper::GetResult(*m_Job));
+
+        // set some node properties
+        newNode->SetProperty("name", mitk::StringProperty::New("material mapped mesh"));
+        newNode->SetProperty("layer", mitk::IntProperty::New(1));
+
+        // add result to the storage
+        this->GetDataStorage()->Add(newNode);
+        m_Controls.stageLabel->setText(QString("done (%1 s)").arg(m_Job->getSeconds(), 0, 'f', 2));
+    } else {
+        m_Controls.stageLabel->setText(m_Job && m_Job->isCancelled() ? "cancelled" : "failed");
+    }
+    m_Job = nullptr;
+
+    m_Controls.cancelButton->setEnabled(false);
+    m_Controls.scrollArea->setEnabled(true);
+}
+
 void MaterialMappingView::tableDataChanged() {
     // in case new data was loaded from a file, we need to update the combo box
     int index = static_cast<int>(m_CalibrationDataModel.getUnit());
@@ -244,11 +274,17 @@ void MaterialMappingView::createEMorganImage() {
     imageCast->Update();
     vtkImage = imageCast->GetOutput();
 
-    for (auto i = 0; i < vtkImage->GetNumberOfPoints(); i++) {
-        auto ct_val = vtkImage->GetPointData()->GetScalars()->GetTuple1(i);
-        auto rho = densityFunctor(ct_val);
-        auto val = powerLawFunctor(rho);
-        vtkImage->GetPointData()->GetScalars()->SetTuple1(i, val);
+    // the cast output is float. The densities of a block are evaluated at once, the power laws keep their double input.
+    auto scalars = static_cast<float *>(vtkImage->GetScalarPointer());
+    auto numberOfPoints = static_cast<std::size_t>(vtkImage->GetNumberOfPoints());
+    const std::size_t blockSize = 4096;
+    std::vector<double> rho(blockSize);
+    for (std::size_t begin = 0; begin < numberOfPoints; begin += blockSize) {
+        auto count = std::min(blockSize, numberOfPoints - begin);
+        densityFunctor.Apply(scalars + begin, rho.data(), count);
+        for (std::size_t i = 0; i < count; ++i) {
+            scalars[begin + i] = static_cast<float>(powerLawFunctor(rho[i]));
+        }
     }
 
     // save results
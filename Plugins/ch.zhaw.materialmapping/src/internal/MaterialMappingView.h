@@ -9,6 +9,8 @@
 #include "CalibrationDataModel.h"
 #include "test/Runner.h"
 #include "BoneDensityFunctor.h"
+#include "ElasticityImageCache.h"
+#include "MaterialMappingJob.h"
 #include "PowerLawWidgetManager.h"
 
 class MaterialMappingView : public QmitkAbstractView {
@@ -22,9 +24,17 @@ public:
     static const bool TESTING = false;
     static Ui::MaterialMappingViewControls *controls;
 
+signals:
+    // emitted from the worker thread
+    void stageFinished(QString _stage);
+    void jobFinished(bool _completed);
+
 protected slots:
     void deleteSelectedRows();
     void startButtonClicked();
+    void cancelButtonClicked();
+    void showStage(QString _stage);
+    void addResult(bool _completed);
     void tableDataChanged();
     void unitSelectionChanged(int);
     void compareGrids();
@@ -43,6 +53,10 @@ protected:
 
     std::unique_ptr<Testing::Runner> m_TestRunner;
     std::unique_ptr<PowerLawWidgetManager> m_PowerLawWidgetManager;
+    // re-runs with the same CT and calibration reuse the E image
+    std::shared_ptr<ElasticityImageCache> m_ElasticityImageCache = std::make_shared<ElasticityImageCache>();
 
+    // only accessed on the GUI thread, the worker holds its own reference
+    std::shared_ptr<MaterialMappingJob> m_Job;
     QFuture<void> m_WorkerFuture;
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+/**
+ * Splits [0, _n) into one contiguous chunk per hardware thread and calls _f(begin, end, threadId) for each of them.
+ * The calling thread works on the first chunk. Returns once all chunks are done.
+ *
+ * If _f throws, the remaining chunks still run to their end. The first exception, in chunk order, is then rethrown on
+ * the calling thread.
+ *
+ * vtkSMPTools is not used on purpose: the VTK shipped with the MITK superbuild uses the sequential backend.
+ */
+template<class TIndex, class TFunction>
+void parallelFor(TIndex _n, TFunction _f, unsigned int _numberOfThreads = std::thread::hardware_concurrency()) {
+    if (_n <= 0) {
+        return;
+    }
+    auto numberOfChunks = std::max<TIndex>(1, std::min<TIndex>(std::max(1u, _numberOfThreads), _n));
+    auto chunkSize = (_n + numberOfChunks - 1) / numberOfChunks;
+
+    std::vector<std::exception_ptr> errors(static_cast<std::size_t>(numberOfChunks));
+    auto run = [&](TIndex _begin, TIndex _end, unsigned int _threadId) {
+        try {
+            _f(_begin, _end, _threadId);
+        } catch (...) {
+            errors[_threadId] = std::current_exception();
+        }
+    };
+
+    {
+        // joins the started threads also if starting another one throws
+        struct JoinGuard {
+            std::vector<std::thread> &threads;
+
+            ~JoinGuard() {
+                for (auto &thread : threads) {
+                    if (thread.joinable()) {
+                        thread.join();
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        JoinGuard joinGuard = {threads};
+
+        for (TIndex i = 1; i < numberOfChunks; ++i) {
+            auto begin = i * chunkSize;
+            auto end = std::min(_n, begin + chunkSize);
+            if (begin < end) {
+                threads.push_back(std::thread(run, begin, end, static_cast<unsigned int>(i)));
+            }
+        }
+        run(TIndex(0), std::min(_n, chunkSize), 0u);
+    }
+
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * Upper bound of the thread ids passed by parallelFor. Useful to allocate per thread accumulators.
+ */
+inline unsigned int parallelForNumberOfThreads(unsigned int _numberOfThreads = std::thread::hardware_concurrency()) {
+    return std::max(1u, _numberOfThreads);
+}
@@ -1,7 +1,34 @@
 #include "PowerLawFunctor.h"
 
+PowerLawFunctor::PowerLawFunctor() {
+    compile();
+}
+
+bool PowerLawFunctor::operator==(const PowerLawFunctor &_other) const {
+    return m_ParamMap == _other.m_ParamMap;
+}
+
+bool PowerLawFunctor::operator!=(const PowerLawFunctor &_other) const {
+    return !(*this == _other);
+}
+
 void PowerLawFunctor::AddPowerLaw(PowerLawParameters _p, double _upperBound) {
     m_ParamMap.insert(std::make_pair(_upperBound, _p));
+    compile();
+}
+
+void PowerLawFunctor::compile() {
+    m_UpperBounds.clear();
+    m_Laws.clear();
+    for (const auto &pair : m_ParamMap) {
+        m_UpperBounds.push_back(pair.first);
+        m_Laws.push_back(pair.second);
+    }
+
+    if (m_Laws.empty()) {
+        m_Laws.push_back(PowerLawParameters(0, 1, 0));
+    }
+    m_LastLaw = m_Laws.size() - 1;
 }
 
 std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f) {
@@ -10,4 +37,4 @@ std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f) {
         _out << "[" << pair.first << "] E = " << pair.second.factor << " * rho ^ " << pair.second.exponent << " + " << pair.second.offset << std::endl;
     }
     return _out;
-}
\ No newline at end of file
+}
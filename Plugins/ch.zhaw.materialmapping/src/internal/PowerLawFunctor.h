@@ -1,33 +1,53 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 #include <map>
 #include <ostream>
+#include <vector>
 
 #include "PowerLawParameters.h"
 
 /**
  * Functor that maintains a map of power laws and their definition intervals.
+ *
+ * Besides the map, the functor keeps a compiled form of the laws: the sorted upper bounds and the parameters in two
+ * contiguous arrays. Evaluation only reads the compiled form and has no mutable state, so a single instance can be
+ * shared by all threads of an image, node or element loop.
  */
 class PowerLawFunctor {
 public:
+    PowerLawFunctor();
+
+    bool operator==(const PowerLawFunctor &_other) const;
+    bool operator!=(const PowerLawFunctor &_other) const;
+
     /**
      * Selects the correct power law for the given rho and applies it.
      */
     template<class TPixel>
     inline double operator()(const TPixel &_rho) const {
-        auto it = m_ParamMap.upper_bound(_rho);
-
-        if (it != cached_it) {  // the PowerLawParameter comparator is rather slow, so we'll use the iterator
-            if (it == m_ParamMap.end()) { // value is out of bounds, fall back on the last defined one
-                cached_param = &(*m_ParamMap.rbegin()).second;
-            } else {
-                cached_param = &(*it).second;
-            }
-            cached_it = it;
+        const auto &law = m_Laws[SelectPowerLaw(_rho)];
+        return law.factor * std::pow(_rho, law.exponent) + law.offset;
+    }
+
+    /**
+     * Index of the power law defined for rho. Equivalent to m_ParamMap.upper_bound(_rho), falling back on the last
+     * power law for out of bounds values.
+     *
+     * The number of power laws is usually 1-4, so counting the bounds <= rho without branching is faster than a
+     * binary search.
+     */
+    inline std::size_t SelectPowerLaw(double _rho) const {
+        std::size_t law = 0;
+        for (std::size_t i = 0; i < m_UpperBounds.size(); ++i) {
+            law += m_UpperBounds[i] <= _rho;
         }
+        return law < m_LastLaw ? law : m_LastLaw;
+    }
 
-        return cached_param->factor * std::pow(_rho, cached_param->exponent) + cached_param->offset;
+    inline const PowerLawParameters &GetPowerLaw(std::size_t _i) const {
+        return m_Laws[_i];
     }
 
     /**
@@ -39,21 +59,18 @@ public:
      */
     void AddPowerLaw(PowerLawParameters _p, double _upperBound);
 
+    friend std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f);
+
+private:
+    void compile();
+
+    // upper bound -> power law. Only modified through AddPowerLaw, which keeps the compiled form in sync.
     std::map<double, PowerLawParameters> m_ParamMap;
 
-public:
-    /**
-     * Currently, the functor is applied in a way like this (pseudo code):
-     * for(auto &point; ugrid->GetPoints()) {
-     *   valCT = img[point];
-     *   valRho = boneDensityFunctor(valCT);
-     *   valEMorgan = powerLawFunctor(valRho);
-     * }
-     * Since the number of power laws is usually rather small and access order of points tends to be favorable, caching
-     * the power law parameters turns out to be a surprisingly big performance boost.
-     */
-    mutable std::map<double, PowerLawParameters>::const_iterator cached_it;
-    mutable PowerLawParameters const *cached_param;
+    // compiled form of m_ParamMap. Without any power law, it holds a single law evaluating to 0.
+    std::vector<double> m_UpperBounds;
+    std::vector<PowerLawParameters> m_Laws;
+    std::size_t m_LastLaw;
 };
 
-std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f);
\ No newline at end of file
+std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f);
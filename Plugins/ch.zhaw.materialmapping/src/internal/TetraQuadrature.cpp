@@ -0,0 +1,74 @@
+#include <algorithm>
+
+#include "TetraQuadrature.h"
+
+namespace {
+    const double Pi = 3.14159265358979323846;
+
+    // Gauss-Legendre points and weights on [0, 1], Newton iteration on the Legendre polynomial
+    void gaussLegendre(unsigned int _n, std::vector<double> &_points, std::vector<double> &_weights) {
+        _points.resize(_n);
+        _weights.resize(_n);
+        for (unsigned int i = 0; i < _n; ++i) {
+            auto x = std::cos(Pi * (i + 0.75) / (_n + 0.5));
+            double derivative = 1;
+            for (auto iteration = 0; iteration < 100; ++iteration) {
+                double p0 = 1, p1 = x;
+                for (unsigned int k = 2; k <= _n; ++k) {
+                    auto p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+                    p0 = p1;
+                    p1 = p2;
+                }
+                derivative = _n * (x * p1 - p0) / (x * x - 1);
+                auto dx = p1 / derivative;
+                x -= dx;
+                if (std::abs(dx) < 1e-15) {
+                    break;
+                }
+            }
+            _points[i] = (1 - x) / 2;
+            _weights[i] = 1 / ((1 - x * x) * derivative * derivative);
+        }
+    }
+}
+
+TetraQuadrature::TetraQuadrature(unsigned int _order) {
+    std::vector<double> points, weights;
+    gaussLegendre(std::max(1u, _order), points, weights);
+
+    for (std::size_t a = 0; a < points.size(); ++a) {
+        for (std::size_t b = 0; b < points.size(); ++b) {
+            for (std::size_t c = 0; c < points.size(); ++c) {
+                auto u = points[a], v = points[b], w = points[c];
+                Point point = {};
+                point.weight = weights[a] * weights[b] * weights[c] * (1 - u) * (1 - u) * (1 - v);
+
+                // collapsed coordinates to barycentric coordinates
+                const double r = u, s = v * (1 - u), t = w * (1 - u) * (1 - v);
+                const double l[4] = {1 - r - s - t, r, s, t};
+                const double dl[4][3] = {{-1, -1, -1}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+
+                for (auto i = 0; i < 4; ++i) {
+                    point.linear[i] = l[i];
+                    point.quadratic[i] = l[i] * (2 * l[i] - 1);
+                    for (auto d = 0; d < 3; ++d) {
+                        point.linearDerivatives[i][d] = dl[i][d];
+                        point.quadraticDerivatives[i][d] = (4 * l[i] - 1) * dl[i][d];
+                    }
+                }
+
+                // mid-edge nodes in VTK order
+                const int edges[6][2] = {{0, 1}, {1, 2}, {2, 0}, {0, 3}, {1, 3}, {2, 3}};
+                for (auto e = 0; e < 6; ++e) {
+                    auto i = edges[e][0], j = edges[e][1];
+                    point.quadratic[4 + e] = 4 * l[i] * l[j];
+                    for (auto d = 0; d < 3; ++d) {
+                        point.quadraticDerivatives[4 + e][d] = 4 * (dl[i][d] * l[j] + l[i] * dl[j][d]);
+                    }
+                }
+
+                m_Points.push_back(point);
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+/**
+ * Gauss quadrature over linear (4 node) and quadratic (10 node, VTK node order) tetras.
+ *
+ * Conical product rule: Gauss-Legendre points in the three collapsed coordinates of the reference tetra, _order^3
+ * points with positive weights, exact for polynomials up to degree 2 * _order - 3. Quadratic tetras are mapped
+ * isoparametrically, so curved edges are integrated with the correct volume weights.
+ */
+class TetraQuadrature {
+public:
+    explicit TetraQuadrature(unsigned int _order);
+
+    std::size_t getNumberOfPoints() const {
+        return m_Points.size();
+    }
+
+    /**
+     * Volume average of _f(x, y, z) over the tetra with the given nodes. _numberOfNodes must be 4 or 10.
+     */
+    template<class TFunction, class TCoordinate, class TId>
+    double average(const TFunction &_f, const TCoordinate *_coordinates, const TId *_pointIds, int _numberOfNodes) const {
+        double nodes[10][3];
+        for (auto i = 0; i < _numberOfNodes; ++i) {
+            for (auto k = 0; k < 3; ++k) {
+                nodes[i][k] = static_cast<double>(_coordinates[3 * _pointIds[i] + k]);
+            }
+        }
+
+        double integral = 0, volume = 0;
+        for (const auto &point : m_Points) {
+            double x[3] = {0, 0, 0}, jacobian[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+            const auto &n = _numberOfNodes == 4 ? point.linear : point.quadratic;
+            const auto &dn = _numberOfNodes == 4 ? point.linearDerivatives : point.quadraticDerivatives;
+            for (auto i = 0; i < _numberOfNodes; ++i) {
+                for (auto k = 0; k < 3; ++k) {
+                    x[k] += n[i] * nodes[i][k];
+                    for (auto d = 0; d < 3; ++d) {
+                        jacobian[k][d] += dn[i][d] * nodes[i][k];
+                    }
+                }
+            }
+            auto determinant = jacobian[0][0] * (jacobian[1][1] * jacobian[2][2] - jacobian[1][2] * jacobian[2][1])
+                               - jacobian[0][1] * (jacobian[1][0] * jacobian[2][2] - jacobian[1][2] * jacobian[2][0])
+                               + jacobian[0][2] * (jacobian[1][0] * jacobian[2][1] - jacobian[1][1] * jacobian[2][0]);
+            auto w = point.weight * std::abs(determinant);
+            integral += w * _f(x[0], x[1], x[2]);
+            volume += w;
+        }
+        return integral / volume;
+    }
+
+private:
+    struct Point {
+        double weight;
+        double linear[10], linearDerivatives[10][3];
+        double quadratic[10], quadraticDerivatives[10][3];
+    };
+
+    std::vector<Point> m_Points;
+};
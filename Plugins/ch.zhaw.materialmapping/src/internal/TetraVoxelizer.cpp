@@ -0,0 +1,77 @@
+#include <cmath>
+
+#include "TetraVoxelizer.h"
+
+namespace {
+    // voxel centers this close to a face (in barycentric coordinates) count as inside, so neighboring tetras leave no
+    // gaps on shared faces
+    const double BarycentricTolerance = 1e-9;
+}
+
+TetraVoxelizer::TetraVoxelizer(const double _origin[3], const double _spacing[3], const int _dimensions[3]) {
+    for (auto i = 0; i < 3; ++i) {
+        m_Origin[i] = _origin[i];
+        m_Spacing[i] = _spacing[i];
+        m_Dimensions[i] = _dimensions[i];
+    }
+}
+
+void TetraVoxelizer::rasterize(const double _corners[4][3], std::ptrdiff_t _zBegin, std::ptrdiff_t _zEnd,
+                               unsigned char *_mask) const {
+    // voxel bounding box, clipped to the image and the slab
+    std::ptrdiff_t lo[3], hi[3];
+    for (auto k = 0; k < 3; ++k) {
+        auto min = std::min(std::min(_corners[0][k], _corners[1][k]), std::min(_corners[2][k], _corners[3][k]));
+        auto max = std::max(std::max(_corners[0][k], _corners[1][k]), std::max(_corners[2][k], _corners[3][k]));
+        lo[k] = static_cast<std::ptrdiff_t>(std::ceil((min - m_Origin[k]) / m_Spacing[k] - BarycentricTolerance));
+        hi[k] = static_cast<std::ptrdiff_t>(std::floor((max - m_Origin[k]) / m_Spacing[k] + BarycentricTolerance));
+        lo[k] = std::max<std::ptrdiff_t>(lo[k], 0);
+        hi[k] = std::min<std::ptrdiff_t>(hi[k], m_Dimensions[k] - 1);
+    }
+    lo[2] = std::max(lo[2], _zBegin);
+    hi[2] = std::min(hi[2], _zEnd - 1);
+    if (lo[0] > hi[0] || lo[1] > hi[1] || lo[2] > hi[2]) {
+        return;
+    }
+
+    // barycentric coordinates: l = inverse(e1 e2 e3) * (p - c0), with the edges e_j = c_j - c0 as columns
+    double e[3][3];
+    for (auto j = 0; j < 3; ++j) {
+        for (auto k = 0; k < 3; ++k) {
+            e[k][j] = _corners[j + 1][k] - _corners[0][k];
+        }
+    }
+    double inverse[3][3] = {
+            {e[1][1] * e[2][2] - e[1][2] * e[2][1], e[0][2] * e[2][1] - e[0][1] * e[2][2], e[0][1] * e[1][2] - e[0][2] * e[1][1]},
+            {e[1][2] * e[2][0] - e[1][0] * e[2][2], e[0][0] * e[2][2] - e[0][2] * e[2][0], e[0][2] * e[1][0] - e[0][0] * e[1][2]},
+            {e[1][0] * e[2][1] - e[1][1] * e[2][0], e[0][1] * e[2][0] - e[0][0] * e[2][1], e[0][0] * e[1][1] - e[0][1] * e[1][0]}
+    };
+    auto determinant = e[0][0] * inverse[0][0] + e[0][1] * inverse[1][0] + e[0][2] * inverse[2][0];
+    if (determinant == 0) {
+        return; // degenerate, covers no volume
+    }
+    for (auto &row : inverse) {
+        for (auto &v : row) {
+            v /= determinant;
+        }
+    }
+
+    const auto incrementZ = m_Dimensions[0] * m_Dimensions[1];
+    for (auto z = lo[2]; z <= hi[2]; ++z) {
+        auto dz = m_Origin[2] + z * m_Spacing[2] - _corners[0][2];
+        for (auto y = lo[1]; y <= hi[1]; ++y) {
+            auto dy = m_Origin[1] + y * m_Spacing[1] - _corners[0][1];
+            auto row = _mask + z * incrementZ + y * m_Dimensions[0];
+            for (auto x = lo[0]; x <= hi[0]; ++x) {
+                auto dx = m_Origin[0] + x * m_Spacing[0] - _corners[0][0];
+                auto l1 = inverse[0][0] * dx + inverse[0][1] * dy + inverse[0][2] * dz;
+                auto l2 = inverse[1][0] * dx + inverse[1][1] * dy + inverse[1][2] * dz;
+                auto l3 = inverse[2][0] * dx + inverse[2][1] * dy + inverse[2][2] * dz;
+                if (l1 >= -BarycentricTolerance && l2 >= -BarycentricTolerance && l3 >= -BarycentricTolerance &&
+                    l1 + l2 + l3 <= 1 + BarycentricTolerance) {
+                    row[x] = 1;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "ParallelFor.h"
+
+/**
+ * Marks the voxels whose center lies inside (or on the boundary of) at least one tetrahedron of a volume mesh.
+ *
+ * Works directly on the tetras instead of scan converting the mesh surface, so the mask follows the mesh topology
+ * exactly, including internal faces and multiple bodies. Each tetra is visited within its voxel bounding box and the
+ * voxel centers are tested with barycentric coordinates. Parallel over z slabs: every thread owns a range of slices,
+ * clears it and rasterizes the part of each tetra that falls into it, so no two threads write the same voxel.
+ */
+class TetraVoxelizer {
+public:
+    /**
+     * _origin is the world position of the first voxel of the buffer, _dimensions in VTK order (x fastest).
+     */
+    TetraVoxelizer(const double _origin[3], const double _spacing[3], const int _dimensions[3]);
+
+    /**
+     * Writes 1 for covered voxels and 0 otherwise into _mask. Tetra i has the point ids _corners[4 * i] to
+     * _corners[4 * i + 3], which index the xyz triplets of _coordinates.
+     */
+    template<class TCoordinate, class TId>
+    void voxelize(const TCoordinate *_coordinates, const TId *_corners, std::size_t _numberOfTetras,
+                  unsigned char *_mask) const {
+        const auto sliceSize = m_Dimensions[0] * m_Dimensions[1];
+        parallelFor(m_Dimensions[2], [&](std::ptrdiff_t _zBegin, std::ptrdiff_t _zEnd, unsigned int) {
+            std::fill(_mask + _zBegin * sliceSize, _mask + _zEnd * sliceSize, 0);
+            double corners[4][3];
+            for (std::size_t i = 0; i < _numberOfTetras; ++i) {
+                for (auto c = 0; c < 4; ++c) {
+                    auto p = _coordinates + 3 * _corners[4 * i + c];
+                    for (auto k = 0; k < 3; ++k) {
+                        corners[c][k] = static_cast<double>(p[k]);
+                    }
+                }
+                rasterize(corners, _zBegin, _zEnd, _mask);
+            }
+        });
+    }
+
+private:
+    void rasterize(const double _corners[4][3], std::ptrdiff_t _zBegin, std::ptrdiff_t _zEnd,
+                   unsigned char *_mask) const;
+
+    double m_Origin[3], m_Spacing[3];
+    std::ptrdiff_t m_Dimensions[3];
+};
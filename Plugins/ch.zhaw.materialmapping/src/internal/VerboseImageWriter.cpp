@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstring>
+
+#include <vtkMetaImageWriter.h>
+
+#include "VerboseImageWriter.h"
+
+namespace {
+    // rounding towards -inf and +inf, extents can be negative
+    int floorDiv(int _a, int _b) {
+        return _a >= 0 ? _a / _b : -((-_a + _b - 1) / _b);
+    }
+
+    int ceilDiv(int _a, int _b) {
+        return _a >= 0 ? (_a + _b - 1) / _b : -(-_a / _b);
+    }
+
+    std::size_t getImageSize(vtkImageData *_image) {
+        return static_cast<std::size_t>(_image->GetNumberOfPoints()) * _image->GetScalarSize() *
+               _image->GetNumberOfScalarComponents();
+    }
+}
+
+VerboseImageWriter::VerboseImageWriter(const std::string &_directory, std::size_t _memoryLimit)
+        : m_Directory(_directory)
+        , m_MemoryLimit(_memoryLimit)
+        , m_Compress(false)
+        , m_Decimation(1)
+        , m_HasRegionOfInterest(false)
+        , m_QueuedBytes(0)
+        , m_Pending(0)
+        , m_Stop(false) {
+    m_Thread = std::thread(&VerboseImageWriter::run, this);
+}
+
+VerboseImageWriter::~VerboseImageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Queued.notify_one();
+    m_Thread.join();
+}
+
+void VerboseImageWriter::setCompression(bool _compress) {
+    m_Compress = _compress;
+}
+
+void VerboseImageWriter::setDecimation(unsigned int _decimation) {
+    m_Decimation = std::max(1u, _decimation);
+}
+
+void VerboseImageWriter::setRegionOfInterest(const int _extent[6]) {
+    m_HasRegionOfInterest = true;
+    std::copy(_extent, _extent + 6, m_RegionOfInterest);
+}
+
+void VerboseImageWriter::write(const std::string &_filename, vtkImageData *_image) {
+    auto snapshot = createSnapshot(_image, m_HasRegionOfInterest ? m_RegionOfInterest : nullptr, m_Decimation);
+    if (snapshot == nullptr) {
+        return;
+    }
+    auto size = getImageSize(snapshot);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    // an image larger than the limit waits for an empty queue
+    m_Written.wait(lock, [&]() {
+        return m_Queue.empty() || m_QueuedBytes + size <= m_MemoryLimit;
+    });
+    Entry entry = {_filename, snapshot, size};
+    m_Queue.push_back(entry);
+    m_QueuedBytes += size;
+    ++m_Pending;
+    lock.unlock();
+    m_Queued.notify_one();
+}
+
+void VerboseImageWriter::flush() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Written.wait(lock, [&]() {
+        return m_Pending == 0;
+    });
+}
+
+vtkSmartPointer<vtkImageData> VerboseImageWriter::createSnapshot(vtkImageData *_image, const int *_roi,
+                                                                 unsigned int _decimation) {
+    auto step = static_cast<int>(std::max(1u, _decimation));
+    int extent[6], snapshotExtent[6];
+    _image->GetExtent(extent);
+    for (auto axis = 0; axis < 3; ++axis) {
+        auto lo = extent[2 * axis], hi = extent[2 * axis + 1];
+        if (_roi != nullptr) {
+            lo = std::max(lo, _roi[2 * axis]);
+            hi = std::min(hi, _roi[2 * axis + 1]);
+        }
+        snapshotExtent[2 * axis] = ceilDiv(lo, step);
+        snapshotExtent[2 * axis + 1] = floorDiv(hi, step);
+        if (snapshotExtent[2 * axis] > snapshotExtent[2 * axis + 1]) {
+            return nullptr;
+        }
+    }
+
+    double spacing[3];
+    _image->GetSpacing(spacing);
+    auto snapshot = vtkSmartPointer<vtkImageData>::New();
+    snapshot->SetOrigin(_image->GetOrigin());
+    snapshot->SetSpacing(spacing[0] * step, spacing[1] * step, spacing[2] * step);
+    snapshot->SetExtent(snapshotExtent);
+    snapshot->AllocateScalars(_image->GetScalarType(), _image->GetNumberOfScalarComponents());
+
+    auto pixelSize = static_cast<std::size_t>(_image->GetScalarSize()) * _image->GetNumberOfScalarComponents();
+    int dims[3];
+    _image->GetDimensions(dims);
+    auto source = static_cast<const char *>(_image->GetScalarPointer());
+    auto target = static_cast<char *>(snapshot->GetScalarPointer());
+    auto rowLength = snapshotExtent[1] - snapshotExtent[0] + 1;
+
+    for (auto z = snapshotExtent[4]; z <= snapshotExtent[5]; ++z) {
+        for (auto y = snapshotExtent[2]; y <= snapshotExtent[3]; ++y) {
+            auto row = source + (((static_cast<std::size_t>(z * step - extent[4]) * dims[1]) + (y * step - extent[2])) *
+                                 dims[0] + (snapshotExtent[0] * step - extent[0])) * pixelSize;
+            if (step == 1) {
+                std::memcpy(target, row, rowLength * pixelSize);
+                target += rowLength * pixelSize;
+            } else {
+                for (auto x = 0; x < rowLength; ++x) {
+                    std::memcpy(target, row + x * step * pixelSize, pixelSize);
+                    target += pixelSize;
+                }
+            }
+        }
+    }
+    return snapshot;
+}
+
+void VerboseImageWriter::run() {
+    for (;;) {
+        Entry entry;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Queued.wait(lock, [&]() {
+                return m_Stop || !m_Queue.empty();
+            });
+            if (m_Queue.empty()) {
+                return; // stopped and drained
+            }
+            entry = m_Queue.front();
+            m_Queue.pop_front();
+            // the snapshot is owned by the entry now, its memory still counts until it is written
+        }
+
+        auto writer = vtkSmartPointer<vtkMetaImageWriter>::New();
+        writer->SetFileName((m_Directory + "/" + entry.filename).c_str());
+        writer->SetCompression(m_Compress);
+        writer->SetInputData(entry.image);
+        writer->Write();
+        entry.image = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_QueuedBytes -= entry.size;
+            --m_Pending;
+        }
+        m_Written.notify_all();
+    }
+}
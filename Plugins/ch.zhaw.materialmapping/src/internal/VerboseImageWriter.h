@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/**
+ * Writes the intermediate images of MaterialMappingFilter as MetaImages on a background thread.
+ *
+ * write() only copies the image, since the filter keeps modifying it in place, and returns. The copies wait in a queue
+ * bounded by memory: write() blocks while the queue is full. Optionally, only a region of interest and every n-th voxel
+ * along each axis are copied, and the writer compresses the files.
+ *
+ * write() is thread safe. Configure the writer before the first write. The destructor waits for all queued images.
+ */
+class VerboseImageWriter {
+public:
+    static const std::size_t DefaultMemoryLimit = std::size_t(512) << 20;
+
+    VerboseImageWriter(const std::string &_directory, std::size_t _memoryLimit = DefaultMemoryLimit);
+    ~VerboseImageWriter();
+
+    VerboseImageWriter(const VerboseImageWriter &) = delete;
+    VerboseImageWriter &operator=(const VerboseImageWriter &) = delete;
+
+    void setCompression(bool _compress);
+
+    /**
+     * Keeps every _decimation-th voxel along each axis, 1 (default) keeps all.
+     */
+    void setDecimation(unsigned int _decimation);
+
+    /**
+     * Structured extent (x0, x1, y0, y1, z0, z1) in voxels of the CT. Images are cropped to it, images outside of it are
+     * not written.
+     */
+    void setRegionOfInterest(const int _extent[6]);
+
+    /**
+     * Queues a copy of _image, written to _filename in the directory of the writer.
+     */
+    void write(const std::string &_filename, vtkImageData *_image);
+
+    /**
+     * Blocks until all queued images are written.
+     */
+    void flush();
+
+    /**
+     * The part of _image that is written: the voxels inside _roi (nullptr for all) whose indices are multiples of
+     * _decimation. Origin and spacing are set so the voxels keep their position. nullptr if no voxel is left.
+     */
+    static vtkSmartPointer<vtkImageData> createSnapshot(vtkImageData *_image, const int *_roi, unsigned int _decimation);
+
+private:
+    struct Entry {
+        std::string filename;
+        vtkSmartPointer<vtkImageData> image;
+        std::size_t size;
+    };
+
+    void run();
+
+    std::string m_Directory;
+    std::size_t m_MemoryLimit;
+    bool m_Compress;
+    unsigned int m_Decimation;
+    bool m_HasRegionOfInterest;
+    int m_RegionOfInterest[6];
+
+    std::deque<Entry> m_Queue;
+    std::size_t m_QueuedBytes;
+    std::size_t m_Pending; // queued or being written
+    bool m_Stop;
+    std::mutex m_Mutex;
+    std::condition_variable m_Queued, m_Written;
+    std::thread m_Thread;
+};
@@ -45,6 +45,26 @@ TEST_CASE("BoneDensityFunctor"){
         REQUIRE(functor2 != functor3);
         REQUIRE(!(functor == functor3));
     }
+
+    SECTION("folded evaluation"){
+        std::vector<float> floatValues {-1024, -0.5f, 0, 0.25f, 1000, 3071};
+        std::vector<short> shortValues {-1024, 0, 1000, 3071};
+        std::vector<float> floatResult(floatValues.size());
+        std::vector<double> shortResult(shortValues.size());
+        functor.Apply(floatValues.data(), floatResult.data(), floatValues.size());
+        functor.Apply(shortValues.data(), shortResult.data(), shortValues.size());
+
+        for(std::size_t i = 0; i < floatValues.size(); ++i){
+            REQUIRE(floatResult[i] == Approx(functor(floatValues[i])).epsilon(1e-6));
+        }
+        for(std::size_t i = 0; i < shortValues.size(); ++i){
+            REQUIRE(shortResult[i] == Approx(functor(shortValues[i])).epsilon(1e-12));
+        }
+
+        // in place
+        functor.Apply(floatValues.data(), floatValues.data(), floatValues.size());
+        REQUIRE(floatValues == floatResult);
+    }
 }
 
 TEST_CASE("BoneDensityParameters"){
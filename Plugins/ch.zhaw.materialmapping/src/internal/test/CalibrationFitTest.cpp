@@ -0,0 +1,160 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../CalibrationFit.h"
+
+TEST_CASE("CalibrationFit"){
+    CalibrationFit fit;
+
+    SECTION("recovers an exact line"){
+        // rho = 0.0008 * HU + 0.05
+        fit.addPoint(-100, -0.03);
+        fit.addPoint(0, 0.05);
+        fit.addPoint(400, 0.37);
+        fit.addPoint(1200, 1.01);
+        auto line = fit.fit();
+        REQUIRE(line.slope == Approx(0.0008).epsilon(1e-12));
+        REQUIRE(line.offset == Approx(0.05).epsilon(1e-12));
+    }
+
+    SECTION("weights"){
+        fit.addPoint(0, 0, 1);
+        fit.addPoint(1, 1, 1);
+        fit.addPoint(2, 0, 1);
+        auto unweighted = fit.fit();
+        REQUIRE(unweighted.slope == Approx(0));
+        REQUIRE(unweighted.offset == Approx(1.0 / 3));
+
+        // half the variance is the same as adding the point twice
+        CalibrationFit weighted, repeated;
+        weighted.addPoint(0, 0, std::sqrt(0.5));
+        weighted.addPoint(1, 1, 1);
+        weighted.addPoint(3, 2, 1);
+        repeated.addPoint(0, 0);
+        repeated.addPoint(0, 0);
+        repeated.addPoint(1, 1);
+        repeated.addPoint(3, 2);
+        REQUIRE(weighted.fit().slope == Approx(repeated.fit().slope));
+        REQUIRE(weighted.fit().offset == Approx(repeated.fit().offset));
+    }
+
+    SECTION("large HU offsets"){
+        // the normal equations lose all digits of the slope here
+        for (auto i = 0; i < 5; ++i) {
+            fit.addPoint(1e9 + i, 2 * i + 1);
+        }
+        auto line = fit.fit();
+        REQUIRE(line.slope == Approx(2).epsilon(1e-9));
+        REQUIRE(line.slope * (1e9 + 3) + line.offset == Approx(7).epsilon(1e-9));
+    }
+
+    SECTION("degenerate input"){
+        REQUIRE(fit.fit().slope == 0);
+        fit.addPoint(100, 0.5);
+        REQUIRE(fit.fit().slope == 0);
+        REQUIRE(fit.fit().offset == 0);
+        fit.addPoint(100, 0.7);
+        REQUIRE(fit.fit().slope == 0);
+        REQUIRE(fit.fit().offset == Approx(0.6));
+    }
+
+    SECTION("inserts"){
+        // two inserts in one image, told apart by the mask
+        std::vector<std::int16_t> image(100000);
+        std::vector<unsigned char> first(image.size()), second(image.size());
+        for (std::size_t i = 0; i < image.size(); ++i) {
+            auto noise = static_cast<int>(i % 21) - 10;
+            if (i % 2 == 0) {
+                image[i] = static_cast<std::int16_t>(100 + noise);
+                first[i] = 1;
+            } else {
+                image[i] = static_cast<std::int16_t>(900 + noise);
+                second[i] = 1;
+            }
+        }
+
+        REQUIRE(fit.addInsert(image.data(), first.data(), image.size(), 0.1));
+        REQUIRE(fit.addInsert(image.data(), second.data(), image.size(), 0.9));
+        REQUIRE(fit.getPoints().size() == 2);
+        CalibrationFit::Statistics noise;
+        for (std::size_t i = 0; i < image.size(); i += 2) {
+            noise.add(image[i]);
+        }
+        REQUIRE(fit.getPoints()[0].weight == Approx(50000 / noise.getVariance()).epsilon(1e-9));
+        REQUIRE(fit.getPoints()[0].hu == Approx(100).epsilon(1e-3));
+        REQUIRE(fit.getPoints()[1].hu == Approx(900).epsilon(1e-3));
+
+        auto line = fit.fit();
+        REQUIRE(line.slope * 100 + line.offset == Approx(0.1).epsilon(1e-3));
+        REQUIRE(line.slope * 900 + line.offset == Approx(0.9).epsilon(1e-3));
+
+        std::vector<unsigned char> empty(image.size());
+        REQUIRE_FALSE(fit.addInsert(image.data(), empty.data(), image.size(), 0.5));
+        REQUIRE(fit.getPoints().size() == 2);
+    }
+
+    SECTION("inserts and single values share the weighting"){
+        // an insert of 4 voxels with a variance of 1 weighs as much as 4 single values with a standard error of 1
+        std::vector<float> insert = {99, 101, 99, 101};
+        CalibrationFit single;
+        for (auto hu : insert) {
+            single.addPoint(hu, 0.1);
+        }
+        fit.addInsert(insert.data(), nullptr, insert.size(), 0.1);
+        double singleWeights = 0;
+        for (const auto &point : single.getPoints()) {
+            singleWeights += point.weight;
+        }
+        REQUIRE(fit.getPoints()[0].weight == Approx(singleWeights));
+
+        // a noisier insert of the same size weighs less, a uniform one is limited by the HU quantization
+        std::vector<float> noisy = {90, 110, 90, 110}, uniform = {100, 100, 100, 100};
+        fit.addInsert(noisy.data(), nullptr, noisy.size(), 0.1);
+        fit.addInsert(uniform.data(), nullptr, uniform.size(), 0.1);
+        REQUIRE(fit.getPoints()[1].weight == Approx(fit.getPoints()[0].weight / 100));
+        REQUIRE(fit.getPoints()[2].weight == Approx(4 * 12));
+    }
+
+    SECTION("outlier rejection"){
+        // a few voxels of cortical bone in a soft tissue insert
+        std::vector<float> image(10000, 50);
+        for (std::size_t i = 0; i < image.size(); ++i) {
+            image[i] += static_cast<float>(i % 5) - 2;
+        }
+        for (std::size_t i = 0; i < 20; ++i) {
+            image[i * 500] = 2000;
+        }
+
+        fit.addInsert(image.data(), nullptr, image.size(), 0.05);
+        REQUIRE(fit.getPoints()[0].hu > 53);
+
+        CalibrationFit robust;
+        robust.setOutlierRejection(3);
+        robust.addInsert(image.data(), nullptr, image.size(), 0.05);
+        CalibrationFit::Statistics inliers;
+        for (auto hu : image) {
+            if (hu < 2000) {
+                inliers.add(hu);
+            }
+        }
+        REQUIRE(inliers.count == image.size() - 20);
+        REQUIRE(robust.getPoints()[0].weight == Approx(inliers.count / inliers.getVariance()).epsilon(1e-9));
+        REQUIRE(robust.getPoints()[0].hu == Approx(50).epsilon(1e-3));
+    }
+
+    SECTION("statistics merge"){
+        CalibrationFit::Statistics all, left, right;
+        for (auto i = 0; i < 1000; ++i) {
+            auto value = 1e6 + (i * 37) % 101;
+            all.add(value);
+            (i < 300 ? left : right).add(value);
+        }
+        left.merge(right);
+        REQUIRE(left.count == all.count);
+        REQUIRE(left.mean == Approx(all.mean).epsilon(1e-12));
+        REQUIRE(left.getVariance() == Approx(all.getVariance()).epsilon(1e-9));
+    }
+}
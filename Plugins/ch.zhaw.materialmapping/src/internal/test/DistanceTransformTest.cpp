@@ -0,0 +1,72 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "../DistanceTransform.h"
+#include "../ExtendImageKernel.h"
+
+namespace {
+    double squaredDistance(std::ptrdiff_t _a, std::ptrdiff_t _b, const int _dim[3]) {
+        std::ptrdiff_t ax = _a % _dim[0], ay = (_a / _dim[0]) % _dim[1], az = _a / (_dim[0] * _dim[1]);
+        std::ptrdiff_t bx = _b % _dim[0], by = (_b / _dim[0]) % _dim[1], bz = _b / (_dim[0] * _dim[1]);
+        return static_cast<double>((ax - bx) * (ax - bx) + (ay - by) * (ay - by) + (az - bz) * (az - bz));
+    }
+}
+
+TEST_CASE("DistanceTransform"){
+    const int dim[3] = {13, 9, 7};
+    const auto n = static_cast<std::ptrdiff_t>(dim[0] * dim[1] * dim[2]);
+
+    std::mt19937 generator(3);
+    std::bernoulli_distribution isSite(0.03);
+    std::vector<unsigned char> mask(n);
+    for (auto &m : mask) {
+        m = isSite(generator);
+    }
+
+    DistanceTransform transform;
+
+    SECTION("matches brute force"){
+        for (auto invert : {false, true}) {
+            transform.compute(mask.data(), dim, invert);
+            for (std::ptrdiff_t i = 0; i < n; ++i) {
+                auto expected = std::numeric_limits<double>::infinity();
+                for (std::ptrdiff_t j = 0; j < n; ++j) {
+                    if ((mask[j] != 0) != invert) {
+                        expected = std::min(expected, squaredDistance(i, j, dim));
+                    }
+                }
+                REQUIRE(transform.getSquaredDistance(i) == expected);
+                auto site = transform.getNearestSite(i);
+                REQUIRE(((mask[site] != 0) != invert));
+                REQUIRE(squaredDistance(i, site, dim) == expected);
+            }
+        }
+    }
+
+    SECTION("dilation reaches as far as the 26-neighbor extend steps"){
+        std::vector<float> image(n, 1);
+        auto extendedMask = mask;
+        ExtendImageKernel kernel(image.data(), extendedMask.data(), dim);
+        for (auto steps = 1u; steps <= 2; ++steps) {
+            kernel.step(false);
+            std::vector<unsigned char> reach(n);
+            DistanceTransform::dilate(mask.data(), dim, steps, reach.data());
+            for (std::ptrdiff_t i = 0; i < n; ++i) {
+                REQUIRE((reach[i] != 0) == (extendedMask[i] != 0));
+            }
+        }
+    }
+
+    SECTION("no sites"){
+        std::vector<unsigned char> empty(n, 0);
+        transform.compute(empty.data(), dim);
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            REQUIRE(transform.getSquaredDistance(i) == std::numeric_limits<double>::infinity());
+            REQUIRE(transform.getNearestSite(i) == -1);
+        }
+    }
+}
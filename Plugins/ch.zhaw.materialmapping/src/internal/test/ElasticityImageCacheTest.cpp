@@ -0,0 +1,103 @@
+#include "catch.hpp"
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "../ElasticityImageCache.h"
+
+namespace {
+    vtkSmartPointer<vtkImageData> createImage(int _size, float _value) {
+        auto image = vtkSmartPointer<vtkImageData>::New();
+        image->SetExtent(0, _size - 1, 0, _size - 1, 0, _size - 1);
+        image->AllocateScalars(VTK_FLOAT, 1);
+        auto scalars = static_cast<float *>(image->GetScalarPointer());
+        for (auto i = 0; i < image->GetNumberOfPoints(); ++i) {
+            scalars[i] = _value;
+        }
+        return image;
+    }
+
+    ElasticityImageCache::Key createKey(const void *_image, unsigned long _modifiedTime) {
+        ElasticityImageCache::Key key;
+        key.image = _image;
+        key.modifiedTime = _modifiedTime;
+        for (auto i = 0; i < 6; ++i) {
+            key.voiExtent[i] = i;
+        }
+        key.border = 4;
+        key.densityFunctor.SetRhoCt(BoneDensityParameters::RhoCt(0.7, 2.5));
+        key.powerLawFunctor.AddPowerLaw(PowerLawParameters(6850, 1.49, 0), 1000);
+        return key;
+    }
+
+    float firstValue(vtkImageData *_image) {
+        return *static_cast<float *>(_image->GetScalarPointer());
+    }
+}
+
+TEST_CASE("ElasticityImageCache"){
+    int ct;
+    const auto imageSize = std::size_t(8 * 8 * 8 * sizeof(float));
+    ElasticityImageCache cache(3 * imageSize);
+    auto key = createKey(&ct, 17);
+    cache.add(key, createImage(8, 1));
+
+    SECTION("returns a copy"){
+        auto image = cache.get(key);
+        REQUIRE(image != nullptr);
+        REQUIRE(firstValue(image) == 1);
+        *static_cast<float *>(image->GetScalarPointer()) = 5;
+        REQUIRE(firstValue(cache.get(key)) == 1);
+    }
+
+    SECTION("misses on any key change"){
+        REQUIRE(cache.get(createKey(&ct, 18)) == nullptr);
+        REQUIRE(cache.get(createKey(&cache, 17)) == nullptr);
+
+        auto otherVoi = key;
+        otherVoi.voiExtent[3] = 7;
+        REQUIRE(cache.get(otherVoi) == nullptr);
+
+        auto otherBorder = key;
+        otherBorder.border = 2;
+        REQUIRE(cache.get(otherBorder) == nullptr);
+
+        auto otherDensity = key;
+        otherDensity.densityFunctor.SetRhoApp(BoneDensityParameters::RhoApp(0.6));
+        REQUIRE(cache.get(otherDensity) == nullptr);
+
+        auto otherPowerLaw = key;
+        otherPowerLaw.powerLawFunctor.AddPowerLaw(PowerLawParameters(1, 1, 0), 2000);
+        REQUIRE(cache.get(otherPowerLaw) == nullptr);
+    }
+
+    SECTION("replaces an entry with the same key"){
+        cache.add(key, createImage(8, 2));
+        REQUIRE(cache.getNumberOfEntries() == 1);
+        REQUIRE(cache.getMemorySize() == imageSize);
+        REQUIRE(firstValue(cache.get(key)) == 2);
+    }
+
+    SECTION("evicts the least recently used entry"){
+        cache.add(createKey(&ct, 18), createImage(8, 2));
+        cache.add(createKey(&ct, 19), createImage(8, 3));
+        REQUIRE(cache.getNumberOfEntries() == 3);
+
+        cache.get(key);
+        cache.add(createKey(&ct, 20), createImage(8, 4));
+        REQUIRE(cache.getNumberOfEntries() == 3);
+        REQUIRE(cache.getMemorySize() == 3 * imageSize);
+        REQUIRE(cache.get(createKey(&ct, 18)) == nullptr);
+        REQUIRE(cache.get(key) != nullptr);
+
+        cache.setMemoryLimit(imageSize);
+        REQUIRE(cache.getNumberOfEntries() == 1);
+        REQUIRE(cache.get(key) != nullptr);
+    }
+
+    SECTION("skips images over the limit"){
+        cache.add(createKey(&ct, 18), createImage(16, 2));
+        REQUIRE(cache.get(createKey(&ct, 18)) == nullptr);
+        REQUIRE(cache.get(key) != nullptr);
+    }
+}
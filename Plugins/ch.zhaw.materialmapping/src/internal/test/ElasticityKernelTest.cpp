@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../ElasticityKernel.h"
+
+TEST_CASE("ElasticityKernel"){
+    BoneDensityFunctor densityFunctor;
+    densityFunctor.SetRhoCt(BoneDensityParameters::RhoCt(0.0008, 0.0012));
+    densityFunctor.SetRhoAsh(BoneDensityParameters::RhoAsh(0.09, 1.14));
+    densityFunctor.SetRhoApp(BoneDensityParameters::RhoApp(0.6));
+
+    PowerLawFunctor powerLawFunctor;
+    powerLawFunctor.AddPowerLaw(PowerLawParameters(6850, 1.49, 0), 0.27);
+    powerLawFunctor.AddPowerLaw(PowerLawParameters(8920, 1.83, 0), 0.6);
+    powerLawFunctor.AddPowerLaw(PowerLawParameters(14664, 1.49, 0), 2.0);
+
+    // reference: the functors, as applied per voxel by MaterialMappingFilter
+    auto expected = [&](double ct){
+        return static_cast<float>(powerLawFunctor(std::max(densityFunctor(ct), 0.0)));
+    };
+
+    std::vector<float> ctValues;
+    for(auto ct = -1024; ct <= 3071; ++ct){
+        ctValues.push_back(static_cast<float>(ct));
+    }
+    ctValues.push_back(-3024.0f);
+    ctValues.push_back(65535.0f);
+
+    ElasticityKernel kernel(densityFunctor, powerLawFunctor);
+
+    SECTION("float buffer within 1 ulp"){
+        std::vector<float> result(ctValues.size());
+        kernel.apply(ctValues.data(), result.data(), ctValues.size());
+        for(std::size_t i = 0; i < ctValues.size(); ++i){
+            auto e = expected(ctValues[i]);
+            REQUIRE(result[i] >= std::nextafter(e, -HUGE_VALF));
+            REQUIRE(result[i] <= std::nextafter(e, HUGE_VALF));
+        }
+    }
+
+    SECTION("in place"){
+        std::vector<float> buffer(ctValues);
+        kernel.apply(buffer.data(), buffer.data(), buffer.size());
+        std::vector<float> result(ctValues.size());
+        kernel.apply(ctValues.data(), result.data(), ctValues.size());
+        REQUIRE(buffer == result);
+    }
+
+    SECTION("integer buffer"){
+        std::vector<short> shortValues(ctValues.begin(), ctValues.end() - 1);
+        std::vector<float> result(shortValues.size());
+        kernel.apply(shortValues.data(), result.data(), shortValues.size());
+        for(std::size_t i = 0; i < shortValues.size(); ++i){
+            REQUIRE(result[i] == static_cast<float>(kernel(shortValues[i])));
+        }
+    }
+
+    SECTION("lookup table"){
+        auto table = kernel.tabulate(-1024, 3071);
+        REQUIRE(table.size() == 4096);
+        for(auto ct = -1024; ct <= 3071; ++ct){
+            REQUIRE(table[ct + 1024] == static_cast<float>(kernel(ct)));
+        }
+        REQUIRE(kernel.tabulate(1, 0).empty());
+    }
+
+    SECTION("zero density"){
+        PowerLawFunctor constantLaw;
+        constantLaw.AddPowerLaw(PowerLawParameters(5, 0, 1), 1);
+        ElasticityKernel constantKernel(densityFunctor, constantLaw);
+        // pow(0, 0) == 1
+        REQUIRE(constantKernel(-3024) == 6.0);
+    }
+}
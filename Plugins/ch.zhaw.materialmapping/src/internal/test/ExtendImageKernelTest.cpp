@@ -0,0 +1,88 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../ExtendImageKernel.h"
+
+namespace {
+    // the former implementation: full 3x3x3 convolution of image * mask and of the mask, evaluated for every voxel
+    void extendByConvolution(std::vector<float> &_image, std::vector<unsigned char> &_mask, const int _dim[3], bool _maxVal) {
+        const double kernel[3] = {1, 1 / sqrt(2), 1 / sqrt(3)};
+        std::vector<float> convImage(_image.size()), convMask(_image.size());
+        for (auto z = 0; z < _dim[2]; ++z) {
+            for (auto y = 0; y < _dim[1]; ++y) {
+                for (auto x = 0; x < _dim[0]; ++x) {
+                    double sumImage = 0, sumMask = 0;
+                    for (auto dz = -1; dz <= 1; ++dz) {
+                        for (auto dy = -1; dy <= 1; ++dy) {
+                            for (auto dx = -1; dx <= 1; ++dx) {
+                                auto nx = x + dx, ny = y + dy, nz = z + dz;
+                                auto distance = (dx != 0) + (dy != 0) + (dz != 0);
+                                if (distance == 0 || nx < 0 || ny < 0 || nz < 0 || nx >= _dim[0] || ny >= _dim[1] || nz >= _dim[2]) {
+                                    continue;
+                                }
+                                auto n = nx + _dim[0] * (ny + _dim[1] * nz);
+                                float maskValue = _mask[n];
+                                sumImage += kernel[distance - 1] * (_image[n] * maskValue);
+                                sumMask += kernel[distance - 1] * maskValue;
+                            }
+                        }
+                    }
+                    auto i = x + _dim[0] * (y + _dim[1] * z);
+                    convImage[i] = static_cast<float>(sumImage);
+                    convMask[i] = static_cast<float>(sumMask);
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < _image.size(); ++i) {
+            if (convMask[i] && !_mask[i]) {
+                auto val = convImage[i] / convMask[i];
+                if (!_maxVal || _image[i] < val) {
+                    _image[i] = val;
+                }
+                _mask[i] = 1;
+            }
+        }
+    }
+}
+
+TEST_CASE("ExtendImageKernel"){
+    const int dim[3] = {23, 17, 11};
+    const auto n = static_cast<std::size_t>(dim[0] * dim[1] * dim[2]);
+
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> values(0, 15000);
+    std::vector<float> image(n);
+    for (auto &v : image) {
+        v = values(generator);
+    }
+
+    // a blob touching the image border, with a hole
+    std::vector<unsigned char> mask(n, 0);
+    for (auto z = 0; z < dim[2]; ++z) {
+        for (auto y = 0; y < dim[1]; ++y) {
+            for (auto x = 0; x < dim[0]; ++x) {
+                auto r = std::sqrt((x - 8.0) * (x - 8.0) + (y - 8.0) * (y - 8.0) + (z - 4.0) * (z - 4.0));
+                mask[x + dim[0] * (y + dim[1] * z)] = r < 7 && r > 2;
+            }
+        }
+    }
+
+    for (auto maxVal : {true, false}) {
+        auto expectedImage = image;
+        auto expectedMask = mask;
+        auto resultImage = image;
+        auto resultMask = mask;
+
+        ExtendImageKernel kernel(resultImage.data(), resultMask.data(), dim);
+        for (auto step = 0; step < 4; ++step) {
+            extendByConvolution(expectedImage, expectedMask, dim, maxVal);
+            kernel.step(maxVal);
+            REQUIRE(resultMask == expectedMask);
+            REQUIRE(resultImage == expectedImage);
+        }
+    }
+}
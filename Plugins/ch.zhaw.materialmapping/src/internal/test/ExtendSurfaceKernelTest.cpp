@@ -0,0 +1,59 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../ExtendSurfaceKernel.h"
+
+// reference implementation
+#include "../lib/extendsurface3d.c"
+
+TEST_CASE("ExtendSurfaceKernel"){
+    const int dim[3] = {19, 14, 9};
+    const auto n = static_cast<std::size_t>(dim[0] * dim[1] * dim[2]);
+
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<float> values(0, 15000);
+    std::vector<float> image(n);
+    for (auto &v : image) {
+        v = values(generator);
+    }
+
+    // a blob touching the image border, with a hole
+    std::vector<unsigned char> mask(n, 0);
+    for (auto z = 0; z < dim[2]; ++z) {
+        for (auto y = 0; y < dim[1]; ++y) {
+            for (auto x = 0; x < dim[0]; ++x) {
+                auto r = std::sqrt((x - 6.0) * (x - 6.0) + (y - 7.0) * (y - 7.0) + (z - 3.0) * (z - 3.0));
+                mask[x + dim[0] * (y + dim[1] * z)] = r < 6 && r > 2;
+            }
+        }
+    }
+
+    for (auto maxVal : {true, false}) {
+        auto expectedImage = image;
+        auto expectedMask = mask;
+        auto resultImage = image;
+        auto resultMask = mask;
+
+        ExtendSurfaceKernel kernel;
+        std::vector<float> extended(n);
+        std::vector<char> extendedMask(n);
+        for (auto step = 0; step < 4; ++step) {
+            // as formerly done by MaterialMappingFilter::inplaceExtendImageOld
+            extendsurface(dim[1], dim[0], dim[2], expectedImage.data(), reinterpret_cast<char *>(expectedMask.data()),
+                          extended.data(), extendedMask.data());
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!maxVal || expectedImage[i] < extended[i]) {
+                    expectedImage[i] = extended[i];
+                }
+                expectedMask[i] = extendedMask[i];
+            }
+
+            kernel.extend(resultImage.data(), resultMask.data(), dim, maxVal);
+            REQUIRE(resultMask == expectedMask);
+            REQUIRE(resultImage == expectedImage);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#include "catch.hpp"
+
+#include <random>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkImageInterpolator.h>
+
+#include "../LinearImageSampler.h"
+
+TEST_CASE("LinearImageSampler"){
+    auto image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent(-3, 12, 2, 20, 5, 9);
+    image->SetOrigin(-10.5, 3.25, 100);
+    image->SetSpacing(0.7, 0.7, 1.25);
+    image->AllocateScalars(VTK_FLOAT, 1);
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> values(-100, 20000);
+    auto scalars = static_cast<float *>(image->GetScalarPointer());
+    for(auto i = 0; i < image->GetNumberOfPoints(); ++i){
+        scalars[i] = values(generator);
+    }
+
+    auto interpolator = vtkSmartPointer<vtkImageInterpolator>::New();
+    interpolator->Initialize(image);
+    interpolator->SetInterpolationModeToLinear();
+    interpolator->Update();
+
+    LinearImageSampler sampler(image);
+    double bounds[6];
+    image->GetBounds(bounds);
+
+    SECTION("identical to vtkImageInterpolator"){
+        // including points slightly outside of the image
+        std::uniform_real_distribution<double> x(bounds[0] - 1, bounds[1] + 1);
+        std::uniform_real_distribution<double> y(bounds[2] - 1, bounds[3] + 1);
+        std::uniform_real_distribution<double> z(bounds[4] - 1, bounds[5] + 1);
+        for(auto i = 0; i < 10000; ++i){
+            double p[3] = {x(generator), y(generator), z(generator)};
+            REQUIRE(sampler(p[0], p[1], p[2]) == interpolator->Interpolate(p[0], p[1], p[2], 0));
+        }
+    }
+
+    SECTION("voxel centers and bounds"){
+        for(auto i = 0; i < image->GetNumberOfPoints(); ++i){
+            double p[3];
+            image->GetPoint(i, p);
+            REQUIRE(sampler(p[0], p[1], p[2]) == interpolator->Interpolate(p[0], p[1], p[2], 0));
+        }
+        REQUIRE(sampler(bounds[1], bounds[3], bounds[5]) == interpolator->Interpolate(bounds[1], bounds[3], bounds[5], 0));
+    }
+}
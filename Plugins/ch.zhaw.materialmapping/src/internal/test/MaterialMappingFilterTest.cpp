@@ -0,0 +1,181 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <vtkCell.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkUnstructuredGrid.h>
+
+#include "../MaterialMappingFilter.h"
+#include "MaterialMappingTestData.h"
+
+namespace {
+    MaterialMappingFilter::Pointer createFilter(MaterialMappingFilter::Method _method, mitk::Image::Pointer _image,
+                                                mitk::UnstructuredGrid::Pointer _mesh) {
+        auto filter = MaterialMappingFilter::New();
+        filter->SetInput(_mesh);
+        filter->SetIntensityImage(_image);
+        filter->SetMethod(_method);
+        filter->SetDensityFunctor(Testing::createMaterialMappingDensityFunctor());
+        filter->SetPowerLawFunctor(Testing::createMaterialMappingPowerLawFunctor());
+        filter->SetNumberOfExtendImageSteps(3);
+        filter->SetMinElementValue(0.01f);
+        return filter;
+    }
+
+    void requireEqualArrays(vtkDataArray *_expected, vtkDataArray *_actual) {
+        REQUIRE(_expected != nullptr);
+        REQUIRE(_actual != nullptr);
+        REQUIRE(_actual->GetNumberOfTuples() == _expected->GetNumberOfTuples());
+        for (vtkIdType i = 0; i < _expected->GetNumberOfTuples(); ++i) {
+            REQUIRE(_actual->GetTuple1(i) == _expected->GetTuple1(i));
+        }
+    }
+
+    // element values as formerly computed by MaterialMappingFilter::nodesToElements, through vtkCell
+    std::vector<double> referenceNodesToElements(vtkUnstructuredGrid *_mesh, vtkDataArray *_nodeData) {
+        std::vector<double> result;
+        for (auto i = 0; i < _mesh->GetNumberOfCells(); ++i) {
+            auto cellpoints = _mesh->GetCell(i)->GetPoints();
+            auto numberOfNodes = cellpoints->GetNumberOfPoints();
+
+            double centroid[3] = {0, 0, 0};
+            for (auto j = 0; j < numberOfNodes; ++j) {
+                auto cellpoint = cellpoints->GetPoint(j);
+                for (auto k = 0; k < 3; ++k) {
+                    centroid[k] = (centroid[k] * j + cellpoint[k]) / (j + 1);
+                }
+            }
+
+            double minDistance = std::numeric_limits<double>::max();
+            std::vector<double> squaredDistances(numberOfNodes);
+            for (auto j = 0; j < numberOfNodes; ++j) {
+                auto cellpoint = cellpoints->GetPoint(j);
+                double squaredDistance = 0;
+                for (auto k = 0; k < 3; ++k) {
+                    squaredDistance += pow(cellpoint[k] - centroid[k], 2);
+                }
+                squaredDistance = sqrt(squaredDistance);
+                squaredDistances.at(j) = squaredDistance;
+                if (squaredDistance == 0)
+                    squaredDistance = 1;
+                if (squaredDistance < minDistance)
+                    minDistance = squaredDistance;
+            }
+
+            double value = 0, denom = 0;
+            for (auto j = 0; j < numberOfNodes; ++j) {
+                auto normalizedWeight = minDistance / squaredDistances.at(j);
+                denom += normalizedWeight;
+                value += normalizedWeight * _nodeData->GetTuple1(_mesh->GetCell(i)->GetPointId(j));
+            }
+            result.push_back(value / denom);
+        }
+        return result;
+    }
+
+    // adds a quadratic tetra, a hexahedron and a cell with more nodes than fit on the stack to a mesh of 4^3 cubes
+    void addOtherCells(vtkUnstructuredGrid *_grid) {
+        auto points = _grid->GetPoints();
+        // corners (0,0,0), (1,0,0), (0,1,0), (0,0,1), point id x + 5 * y + 25 * z
+        vtkIdType quadraticTetra[10] = {0, 1, 5, 25};
+        const int edges[6][2] = {{0, 1}, {1, 2}, {2, 0}, {0, 3}, {1, 3}, {2, 3}};
+        for (auto e = 0; e < 6; ++e) {
+            double a[3], b[3];
+            points->GetPoint(quadraticTetra[edges[e][0]], a);
+            points->GetPoint(quadraticTetra[edges[e][1]], b);
+            quadraticTetra[4 + e] = points->InsertNextPoint((a[0] + b[0]) / 2, (a[1] + b[1]) / 2, (a[2] + b[2]) / 2);
+        }
+        _grid->InsertNextCell(VTK_QUADRATIC_TETRA, 10, quadraticTetra);
+
+        // the cube at (1,1,1)
+        vtkIdType hexahedron[8] = {31, 32, 37, 36, 56, 57, 62, 61};
+        _grid->InsertNextCell(VTK_HEXAHEDRON, 8, hexahedron);
+
+        std::vector<vtkIdType> polyVertex;
+        for (vtkIdType i = 0; i < 40; ++i) {
+            polyVertex.push_back(i);
+        }
+        _grid->InsertNextCell(VTK_POLY_VERTEX, static_cast<vtkIdType>(polyVertex.size()), polyVertex.data());
+    }
+}
+
+TEST_CASE("MaterialMappingFilter unpeeled branch"){
+    auto image = Testing::createMaterialMappingImage();
+    const double min[3] = {3, 6, 4};
+    auto mesh = Testing::createMaterialMappingMesh(min, 12, 4);
+
+    for (auto method : {MaterialMappingFilter::Method::Old, MaterialMappingFilter::Method::New,
+                        MaterialMappingFilter::Method::DistanceTransform}) {
+        // reference: the former two runs, peeled (B, C) and then unpeeled (A) on the peeled output
+        auto peeled = createFilter(method, image, mesh);
+        peeled->SetDoPeelStep(true);
+        peeled->SetPointArrayName("C");
+        peeled->SetCellArrayName("B");
+        auto meshBC = peeled->GetOutput();
+        peeled->Update();
+
+        auto unpeeled = createFilter(method, image, meshBC);
+        unpeeled->SetDoPeelStep(false);
+        unpeeled->SetPointArrayName("");
+        unpeeled->SetCellArrayName("A");
+        auto reference = unpeeled->GetOutput();
+        unpeeled->Update();
+
+        // single pass with the unpeeled branch on its own thread
+        auto filter = createFilter(method, image, mesh);
+        filter->SetDoPeelStep(true);
+        filter->SetPointArrayName("C");
+        filter->SetCellArrayName("B");
+        filter->SetUnpeeledCellArrayName("A");
+        auto result = filter->GetOutput();
+        filter->Update();
+
+        auto expected = reference->GetVtkUnstructuredGrid();
+        auto actual = result->GetVtkUnstructuredGrid();
+        requireEqualArrays(expected->GetPointData()->GetArray("C"), actual->GetPointData()->GetArray("C"));
+        requireEqualArrays(expected->GetCellData()->GetArray("B"), actual->GetCellData()->GetArray("B"));
+        requireEqualArrays(expected->GetCellData()->GetArray("A"), actual->GetCellData()->GetArray("A"));
+    }
+}
+
+TEST_CASE("MaterialMappingFilter element values"){
+    auto image = Testing::createMaterialMappingImage();
+    const double min[3] = {3, 6, 4};
+    auto mesh = Testing::createMaterialMappingMesh(min, 12, 4);
+    auto grid = mesh->GetVtkUnstructuredGrid();
+    addOtherCells(grid);
+
+    SECTION("float coordinates"){
+        REQUIRE(grid->GetPoints()->GetDataType() == VTK_FLOAT);
+    }
+
+    SECTION("double coordinates"){
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        points->SetDataTypeToDouble();
+        for (vtkIdType i = 0; i < grid->GetNumberOfPoints(); ++i) {
+            points->InsertNextPoint(grid->GetPoint(i));
+        }
+        grid->SetPoints(points);
+    }
+
+    // identical to the former implementation, bit for bit
+    auto filter = createFilter(MaterialMappingFilter::Method::New, image, mesh);
+    filter->SetDoPeelStep(true);
+    auto result = filter->GetOutput();
+    filter->Update();
+
+    auto output = result->GetVtkUnstructuredGrid();
+    auto expected = referenceNodesToElements(output, output->GetPointData()->GetArray("E"));
+    auto actual = output->GetCellData()->GetArray("E");
+    REQUIRE(actual->GetNumberOfTuples() == static_cast<vtkIdType>(expected.size()));
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        REQUIRE(actual->GetTuple1(i) == expected[i]);
+    }
+}
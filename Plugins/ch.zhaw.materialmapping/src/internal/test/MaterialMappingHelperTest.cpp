@@ -0,0 +1,102 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkPointData.h>
+#include <vtkUnstructuredGrid.h>
+
+#include "GemIOResources.h"
+
+#include "../MaterialMappingHelper.h"
+#include "MaterialMappingTestData.h"
+
+namespace {
+    void requireEqualArrays(vtkDataArray *_expected, vtkDataArray *_actual) {
+        REQUIRE(_expected != nullptr);
+        REQUIRE(_actual != nullptr);
+        REQUIRE(_actual->GetNumberOfTuples() == _expected->GetNumberOfTuples());
+        for (vtkIdType i = 0; i < _expected->GetNumberOfTuples(); ++i) {
+            REQUIRE(_actual->GetTuple1(i) == Approx(_expected->GetTuple1(i)).epsilon(1e-6));
+        }
+    }
+
+    void requireEqualResults(mitk::UnstructuredGrid::Pointer _expected, mitk::UnstructuredGrid::Pointer _actual) {
+        auto expected = _expected->GetVtkUnstructuredGrid();
+        auto actual = _actual->GetVtkUnstructuredGrid();
+        for (auto name : {GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C, GEM_DATA_ARRAY_NAME_MATMAP_METHOD_D}) {
+            requireEqualArrays(expected->GetPointData()->GetArray(name), actual->GetPointData()->GetArray(name));
+        }
+        for (auto name : {GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A, GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B,
+                          GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E}) {
+            requireEqualArrays(expected->GetCellData()->GetArray(name), actual->GetCellData()->GetArray(name));
+        }
+    }
+
+    double *getPointer(vtkDataArray *_array) {
+        auto array = vtkDoubleArray::SafeDownCast(_array);
+        REQUIRE(array != nullptr);
+        return array->GetPointer(0);
+    }
+}
+
+TEST_CASE("MaterialMappingHelper"){
+    auto image = Testing::createMaterialMappingImage();
+    auto densityFunctor = Testing::createMaterialMappingDensityFunctor();
+    auto powerLawFunctor = Testing::createMaterialMappingPowerLawFunctor();
+    auto method = MaterialMappingFilter::Method::New;
+
+    SECTION("batch equals single runs"){
+        // overlapping, disjoint and nested VOIs
+        const double first[3] = {2, 5, 4}, second[3] = {8, 9, 7}, third[3] = {12, 4, 10};
+        std::vector<mitk::UnstructuredGrid::Pointer> meshes = {
+                Testing::createMaterialMappingMesh(first, 9),
+                Testing::createMaterialMappingMesh(second, 6, 2),
+                Testing::createMaterialMappingMesh(third, 7)
+        };
+
+        auto batch = MaterialMappingHelper::ComputeBatch(meshes, image, method, densityFunctor, powerLawFunctor, 0.01f);
+        REQUIRE(batch.size() == meshes.size());
+        for (std::size_t i = 0; i < meshes.size(); ++i) {
+            auto single = MaterialMappingHelper::Compute(meshes[i], image, method, densityFunctor, powerLawFunctor, 0.01f);
+            requireEqualResults(single, batch[i]);
+        }
+    }
+
+    SECTION("D and E are views of C and A"){
+        const double min[3] = {3, 6, 4};
+        auto result = MaterialMappingHelper::Compute(Testing::createMaterialMappingMesh(min, 12), image, method,
+                                                     densityFunctor, powerLawFunctor, 0.01f);
+        auto grid = result->GetVtkUnstructuredGrid();
+        auto c = grid->GetPointData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C);
+        auto d = grid->GetPointData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_D);
+        auto a = grid->GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A);
+        auto e = grid->GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E);
+        REQUIRE(c->GetNumberOfTuples() == grid->GetNumberOfPoints());
+        REQUIRE(a->GetNumberOfTuples() == grid->GetNumberOfCells());
+        REQUIRE(getPointer(d) == getPointer(c));
+        REQUIRE(getPointer(e) == getPointer(a));
+        requireEqualArrays(c, d);
+        requireEqualArrays(a, e);
+
+        // a copy owns independent arrays that outlive the mapped mesh
+        auto copy = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        copy->DeepCopy(grid);
+        result = nullptr;
+        auto copyC = copy->GetPointData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C);
+        auto copyD = copy->GetPointData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_D);
+        auto copyA = copy->GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A);
+        auto copyE = copy->GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E);
+        REQUIRE(getPointer(copyD) != getPointer(copyC));
+        REQUIRE(getPointer(copyE) != getPointer(copyA));
+        requireEqualArrays(copyC, copyD);
+        requireEqualArrays(copyA, copyE);
+    }
+
+    SECTION("empty batch"){
+        std::vector<mitk::UnstructuredGrid::Pointer> meshes;
+        REQUIRE(MaterialMappingHelper::ComputeBatch(meshes, image, method, densityFunctor, powerLawFunctor, 0.01f).empty());
+    }
+}
@@ -0,0 +1,66 @@
+#include "catch.hpp"
+
+#include "../MaterialMappingJob.h"
+#include "MaterialMappingTestData.h"
+
+namespace {
+    MaterialMappingFilter::Pointer createFilter() {
+        const double min[3] = {3, 6, 4};
+        auto filter = MaterialMappingFilter::New();
+        filter->SetInput(Testing::createMaterialMappingMesh(min, 12));
+        filter->SetIntensityImage(Testing::createMaterialMappingImage());
+        filter->SetDensityFunctor(Testing::createMaterialMappingDensityFunctor());
+        filter->SetPowerLawFunctor(Testing::createMaterialMappingPowerLawFunctor());
+        filter->SetDoPeelStep(true);
+        filter->SetUnpeeledCellArrayName("A");
+        return filter;
+    }
+}
+
+TEST_CASE("MaterialMappingJob"){
+    auto filter = createFilter();
+    MaterialMappingJob job(filter);
+
+    SECTION("completes"){
+        REQUIRE(job.run());
+        REQUIRE_FALSE(job.isCancelled());
+        REQUIRE(job.getStages().front().name == "voi");
+        REQUIRE(job.getStages().back().name == "unpeeled elements");
+    }
+
+    SECTION("cancel before run"){
+        job.cancel();
+        REQUIRE(job.isCancelled());
+        REQUIRE_FALSE(job.run());
+        REQUIRE(job.getStages().empty());
+    }
+
+    SECTION("cancel during a stage"){
+        // the E image is computed after the cancel, the update stops at the end of its stage
+        job.setObserver([&job](const MaterialMappingJob::Stage &_stage) {
+            if (_stage.name == "voi") {
+                job.cancel();
+            }
+        });
+        REQUIRE_FALSE(job.run());
+        REQUIRE(job.isCancelled());
+        REQUIRE(job.getStages().size() == 1);
+        REQUIRE(job.getStages().front().name == "voi");
+    }
+
+    SECTION("run again after a cancel"){
+        job.cancel();
+        REQUIRE_FALSE(job.run());
+        REQUIRE(job.run());
+        REQUIRE_FALSE(job.isCancelled());
+        REQUIRE(job.getStages().back().name == "unpeeled elements");
+    }
+
+    SECTION("a cancel after the update does not abort the next one"){
+        REQUIRE(job.run());
+        filter->Cancel();
+        filter->Modified();
+        filter->Update();
+        REQUIRE_FALSE(filter->IsCancelled());
+    }
+}
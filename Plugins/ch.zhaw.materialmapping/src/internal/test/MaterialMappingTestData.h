@@ -0,0 +1,92 @@
+#pragma once
+
+#include <limits>
+
+#include <mitkImage.h>
+#include <mitkUnstructuredGrid.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkPoints.h>
+#include <vtkUnstructuredGrid.h>
+
+#include "../BoneDensityFunctor.h"
+#include "../PowerLawFunctor.h"
+
+namespace Testing {
+    /*
+     * Small synthetic input for tests of the whole material mapping: a short CT with some structure, so that the peel
+     * and extend steps change the result, and tetra meshes of cubes inside it.
+     */
+
+    // _size^3 voxels of 1mm
+    static mitk::Image::Pointer createMaterialMappingImage(int _size = 24){
+        auto vtkImage = vtkSmartPointer<vtkImageData>::New();
+        vtkImage->SetExtent(0, _size - 1, 0, _size - 1, 0, _size - 1);
+        vtkImage->SetOrigin(-2, 1, 0.5);
+        vtkImage->SetSpacing(1, 1, 1);
+        vtkImage->AllocateScalars(VTK_SHORT, 1);
+        auto scalars = static_cast<short *>(vtkImage->GetScalarPointer());
+        for(auto z = 0; z < _size; ++z){
+            for(auto y = 0; y < _size; ++y){
+                for(auto x = 0; x < _size; ++x){
+                    *scalars++ = static_cast<short>(200 + 10 * x + 5 * y + 37 * ((7 * x + 3 * y + 5 * z) % 11));
+                }
+            }
+        }
+
+        auto image = mitk::Image::New();
+        image->Initialize(vtkImage);
+        image->SetVolume(vtkImage->GetScalarPointer());
+        return image;
+    }
+
+    // axis aligned cube from _min with edge length _length, _n^3 sub cubes of 6 tetras each
+    static mitk::UnstructuredGrid::Pointer createMaterialMappingMesh(const double _min[3], double _length, int _n = 3){
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        for(auto z = 0; z <= _n; ++z){
+            for(auto y = 0; y <= _n; ++y){
+                for(auto x = 0; x <= _n; ++x){
+                    points->InsertNextPoint(_min[0] + x * _length / _n, _min[1] + y * _length / _n, _min[2] + z * _length / _n);
+                }
+            }
+        }
+
+        // Kuhn triangulation: every tetra runs from corner 0 to corner 7 along the edges of one axis permutation
+        const int paths[6][2] = {{1, 3}, {1, 5}, {2, 3}, {2, 6}, {4, 5}, {4, 6}};
+        auto grid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        grid->SetPoints(points);
+        for(auto z = 0; z < _n; ++z){
+            for(auto y = 0; y < _n; ++y){
+                for(auto x = 0; x < _n; ++x){
+                    vtkIdType corners[8];
+                    for(auto c = 0; c < 8; ++c){
+                        corners[c] = (x + (c & 1)) + (_n + 1) * ((y + ((c >> 1) & 1)) + (_n + 1) * (z + ((c >> 2) & 1)));
+                    }
+                    for(const auto &path : paths){
+                        vtkIdType tetra[4] = {corners[0], corners[path[0]], corners[path[1]], corners[7]};
+                        grid->InsertNextCell(VTK_TETRA, 4, tetra);
+                    }
+                }
+            }
+        }
+
+        auto mesh = mitk::UnstructuredGrid::New();
+        mesh->SetVtkUnstructuredGrid(grid);
+        return mesh;
+    }
+
+    static BoneDensityFunctor createMaterialMappingDensityFunctor(){
+        BoneDensityFunctor functor;
+        functor.SetRhoCt(BoneDensityParameters::RhoCt(0.0008, 0.05));
+        functor.SetRhoAsh(BoneDensityParameters::RhoAsh(0.079, 0.877));
+        functor.SetRhoApp(BoneDensityParameters::RhoApp(0.6));
+        return functor;
+    }
+
+    static PowerLawFunctor createMaterialMappingPowerLawFunctor(){
+        PowerLawFunctor functor;
+        functor.AddPowerLaw(PowerLawParameters(6850, 1.49, 0), std::numeric_limits<float>::max());
+        return functor;
+    }
+}
@@ -0,0 +1,59 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "../ParallelFor.h"
+
+TEST_CASE("parallelFor"){
+    std::vector<int> visits(1000, 0);
+
+    SECTION("visits every index once"){
+        // Catch is not thread safe, the workers only count
+        std::atomic<int> calls(0);
+        std::atomic<unsigned int> threadIds(0);
+        parallelFor(visits.size(), [&](std::size_t _begin, std::size_t _end, unsigned int _threadId) {
+            threadIds |= 1u << _threadId;
+            for (auto i = _begin; i < _end; ++i) {
+                ++visits[i];
+            }
+            ++calls;
+        }, 4);
+        REQUIRE(calls == 4);
+        REQUIRE(threadIds == 15u);
+        REQUIRE(visits == std::vector<int>(visits.size(), 1));
+    }
+
+    SECTION("empty range"){
+        auto called = false;
+        parallelFor(0, [&](int, int, unsigned int) {
+            called = true;
+        });
+        REQUIRE_FALSE(called);
+    }
+
+    SECTION("exceptions reach the caller"){
+        // thrown on the calling thread and on a worker, the other chunks still complete
+        for (unsigned int thrower : {0u, 3u}) {
+            std::fill(visits.begin(), visits.end(), 0);
+            auto chunk = [&](std::size_t _begin, std::size_t _end, unsigned int _threadId) {
+                if (_threadId == thrower) {
+                    throw std::runtime_error("chunk failed");
+                }
+                for (auto i = _begin; i < _end; ++i) {
+                    ++visits[i];
+                }
+            };
+            auto thrown = false;
+            try {
+                parallelFor(visits.size(), chunk, 4);
+            } catch (const std::runtime_error &) {
+                thrown = true;
+            }
+            REQUIRE(thrown);
+            REQUIRE(std::count(visits.begin(), visits.end(), 1) == 750);
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
 #include <cmath>
+#include <thread>
+#include <vector>
 
 #include "../PowerLawParameters.h"
 #include "../PowerLawFunctor.h"
@@ -44,4 +46,66 @@ TEST_CASE("PowerLawFunctor"){
             REQUIRE( result == expectedFunctor(nr));
         }
     }
-}
\ No newline at end of file
+
+    SECTION("shared between threads"){
+        std::vector<double> numbers;
+        for(auto x = -500.0; x < 500.0; x += 0.25){
+            numbers.push_back(x);
+        }
+
+        std::vector<double> serial;
+        for(const auto &nr : numbers){
+            serial.push_back(functor(nr));
+        }
+
+        // each thread walks the numbers in a different order, which broke the former iterator cache
+        std::vector<std::vector<double>> parallel(4, std::vector<double>(numbers.size()));
+        std::vector<std::thread> threads;
+        for(auto t = 0u; t < parallel.size(); ++t){
+            threads.push_back(std::thread([&, t](){
+                for(std::size_t i = 0; i < numbers.size(); ++i){
+                    auto shifted = (i + t * numbers.size() / parallel.size()) % numbers.size();
+                    auto idx = t % 2 ? numbers.size() - 1 - shifted : shifted;
+                    parallel[t][idx] = functor(numbers[idx]);
+                }
+            }));
+        }
+        for(auto &thread : threads){
+            thread.join();
+        }
+
+        for(const auto &result : parallel){
+            REQUIRE(result == serial);
+        }
+    }
+
+    SECTION("equal upper bounds keep the law added first"){
+        PowerLawFunctor functor2(functor);
+        functor2.AddPowerLaw(PowerLawParameters(100, 1, 0), 200);
+        REQUIRE(functor2(150) == functor(150));
+    }
+
+    SECTION("comparators"){
+        PowerLawFunctor same;
+        same.AddPowerLaw(p2, 300);
+        same.AddPowerLaw(p0, 0);
+        same.AddPowerLaw(p1, 200);
+        REQUIRE(functor == same);
+
+        PowerLawFunctor otherBound(same);
+        otherBound.AddPowerLaw(p0, 400);
+        REQUIRE(functor != otherBound);
+
+        PowerLawFunctor otherLaw;
+        otherLaw.AddPowerLaw(p0, 0);
+        otherLaw.AddPowerLaw(p2, 200);
+        otherLaw.AddPowerLaw(p2, 300);
+        REQUIRE(functor != otherLaw);
+    }
+}
+
+TEST_CASE("PowerLawFunctor without power laws"){
+    PowerLawFunctor functor;
+    REQUIRE(functor.SelectPowerLaw(0.5) == 0);
+    REQUIRE(functor(0.5) == 0);
+}
@@ -0,0 +1,84 @@
+#include "catch.hpp"
+
+#include <cmath>
+
+#include "../TetraQuadrature.h"
+
+namespace {
+    struct Monomial {
+        int a, b, c;
+
+        double operator()(double _x, double _y, double _z) const {
+            return std::pow(_x, a) * std::pow(_y, b) * std::pow(_z, c);
+        }
+    };
+
+    double factorial(int _n) {
+        return _n <= 1 ? 1 : _n * factorial(_n - 1);
+    }
+
+    // a! b! c! / (a + b + c + 3)! over the reference tetra, divided by its volume 1/6
+    double referenceAverage(const Monomial &_m) {
+        return 6 * factorial(_m.a) * factorial(_m.b) * factorial(_m.c) / factorial(_m.a + _m.b + _m.c + 3);
+    }
+}
+
+TEST_CASE("TetraQuadrature"){
+    const double reference[] = {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+    const int ids[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+    SECTION("exact for polynomials up to degree 2 * order - 3"){
+        for (auto order : {2u, 3u, 4u}) {
+            TetraQuadrature quadrature(order);
+            REQUIRE(quadrature.getNumberOfPoints() == order * order * order);
+            for (auto a = 0; a <= 3; ++a) {
+                for (auto b = 0; a + b <= 3; ++b) {
+                    for (auto c = 0; a + b + c <= static_cast<int>(2 * order - 3); ++c) {
+                        Monomial m = {a, b, c};
+                        REQUIRE(quadrature.average(m, reference, ids, 4) == Approx(referenceAverage(m)).epsilon(1e-12));
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("affine tetras"){
+        TetraQuadrature quadrature(3);
+        const double corners[] = {1, 2, 3, 4, 2.5, 3, 1.5, 5, 3.5, 2, 2, 7};
+        auto x = [](double _x, double, double) { return _x; };
+        auto one = [](double, double, double) { return 1.0; };
+        REQUIRE(quadrature.average(one, corners, ids, 4) == Approx(1.0));
+        REQUIRE(quadrature.average(x, corners, ids, 4) == Approx((1 + 4 + 1.5 + 2) / 4.0));
+
+        // straight edged quadratic tetra: same geometry, same result
+        double nodes[30];
+        const int edges[6][2] = {{0, 1}, {1, 2}, {2, 0}, {0, 3}, {1, 3}, {2, 3}};
+        for (auto i = 0; i < 12; ++i) {
+            nodes[i] = corners[i];
+        }
+        for (auto e = 0; e < 6; ++e) {
+            for (auto k = 0; k < 3; ++k) {
+                nodes[3 * (4 + e) + k] = (corners[3 * edges[e][0] + k] + corners[3 * edges[e][1] + k]) / 2;
+            }
+        }
+        auto f = [](double _x, double _y, double _z) { return _x * _y + _z * _z; };
+        REQUIRE(quadrature.average(f, nodes, ids, 10) == Approx(quadrature.average(f, corners, ids, 4)).epsilon(1e-12));
+    }
+
+    SECTION("curved quadratic tetra"){
+        // reference tetra with the mid node of edge (0, 1) moved off the edge. The volume changes, a constant does not.
+        double nodes[30] = {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+        const int edges[6][2] = {{0, 1}, {1, 2}, {2, 0}, {0, 3}, {1, 3}, {2, 3}};
+        for (auto e = 0; e < 6; ++e) {
+            for (auto k = 0; k < 3; ++k) {
+                nodes[3 * (4 + e) + k] = (nodes[3 * edges[e][0] + k] + nodes[3 * edges[e][1] + k]) / 2;
+            }
+        }
+        nodes[3 * 4 + 1] = -0.1;
+        TetraQuadrature quadrature(3);
+        auto one = [](double, double, double) { return 1.0; };
+        auto y = [](double, double _y, double) { return _y; };
+        REQUIRE(quadrature.average(one, nodes, ids, 10) == Approx(1.0));
+        REQUIRE(quadrature.average(y, nodes, ids, 10) < 0.25);
+    }
+}
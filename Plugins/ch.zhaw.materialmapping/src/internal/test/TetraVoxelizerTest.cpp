@@ -0,0 +1,98 @@
+#include "catch.hpp"
+
+#include <random>
+#include <vector>
+
+#include "../TetraVoxelizer.h"
+
+namespace {
+    double orientation(const double *_a, const double *_b, const double *_c, const double *_d) {
+        double u[3], v[3], w[3];
+        for (auto k = 0; k < 3; ++k) {
+            u[k] = _b[k] - _a[k];
+            v[k] = _c[k] - _a[k];
+            w[k] = _d[k] - _a[k];
+        }
+        return u[0] * (v[1] * w[2] - v[2] * w[1]) - u[1] * (v[0] * w[2] - v[2] * w[0]) + u[2] * (v[0] * w[1] - v[1] * w[0]);
+    }
+
+    // p is inside if it lies on the same side of every face as the opposite corner
+    bool isInside(const std::vector<double> &_coordinates, const long *_corners, const double *_p) {
+        const double *c[4];
+        for (auto i = 0; i < 4; ++i) {
+            c[i] = &_coordinates[3 * _corners[i]];
+        }
+        const int faces[4][4] = {{1, 2, 3, 0}, {0, 2, 3, 1}, {0, 1, 3, 2}, {0, 1, 2, 3}};
+        for (const auto &f : faces) {
+            if (orientation(c[f[0]], c[f[1]], c[f[2]], c[f[3]]) * orientation(c[f[0]], c[f[1]], c[f[2]], _p) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE("TetraVoxelizer"){
+    const double origin[3] = {-2.5, 1.25, 0.5};
+    const double spacing[3] = {0.5, 0.75, 1.0};
+    const int dim[3] = {19, 13, 11};
+    const auto n = static_cast<std::size_t>(dim[0] * dim[1] * dim[2]);
+    TetraVoxelizer voxelizer(origin, spacing, dim);
+
+    SECTION("matches a brute force inside test"){
+        std::mt19937 generator(11);
+        std::uniform_real_distribution<double> x(-4, 8), y(0, 12), z(-1, 13);
+        std::vector<double> coordinates;
+        std::vector<long> corners;
+        for (auto i = 0; i < 20; ++i) {
+            auto first = static_cast<long>(coordinates.size() / 3);
+            for (auto c = 0; c < 4; ++c) {
+                coordinates.push_back(x(generator));
+                coordinates.push_back(y(generator));
+                coordinates.push_back(z(generator));
+                corners.push_back(first + c);
+            }
+        }
+
+        std::vector<unsigned char> mask(n, 7);
+        voxelizer.voxelize(coordinates.data(), corners.data(), corners.size() / 4, mask.data());
+
+        for (auto vz = 0; vz < dim[2]; ++vz) {
+            for (auto vy = 0; vy < dim[1]; ++vy) {
+                for (auto vx = 0; vx < dim[0]; ++vx) {
+                    double p[3] = {origin[0] + vx * spacing[0], origin[1] + vy * spacing[1], origin[2] + vz * spacing[2]};
+                    bool expected = false;
+                    for (std::size_t t = 0; t < corners.size() / 4; ++t) {
+                        expected = expected || isInside(coordinates, &corners[4 * t], p);
+                    }
+                    REQUIRE(mask[vx + dim[0] * (vy + dim[1] * vz)] == expected);
+                }
+            }
+        }
+    }
+
+    SECTION("tetrahedralized box has no gaps"){
+        // box from voxel (1, 2, 3) to voxel (9, 6, 7), boundary on voxel centers, split into 6 tetras along a diagonal
+        const double lo[3] = {origin[0] + 1 * spacing[0], origin[1] + 2 * spacing[1], origin[2] + 3 * spacing[2]};
+        const double hi[3] = {origin[0] + 9 * spacing[0], origin[1] + 6 * spacing[1], origin[2] + 7 * spacing[2]};
+        std::vector<float> coordinates;
+        for (auto c = 0; c < 8; ++c) {
+            coordinates.push_back(static_cast<float>(c & 1 ? hi[0] : lo[0]));
+            coordinates.push_back(static_cast<float>(c & 2 ? hi[1] : lo[1]));
+            coordinates.push_back(static_cast<float>(c & 4 ? hi[2] : lo[2]));
+        }
+        const int corners[] = {0, 1, 3, 7, 0, 1, 5, 7, 0, 2, 3, 7, 0, 2, 6, 7, 0, 4, 5, 7, 0, 4, 6, 7};
+
+        std::vector<unsigned char> mask(n, 7);
+        voxelizer.voxelize(coordinates.data(), corners, 6, mask.data());
+
+        for (auto vz = 0; vz < dim[2]; ++vz) {
+            for (auto vy = 0; vy < dim[1]; ++vy) {
+                for (auto vx = 0; vx < dim[0]; ++vx) {
+                    bool expected = vx >= 1 && vx <= 9 && vy >= 2 && vy <= 6 && vz >= 3 && vz <= 7;
+                    REQUIRE(mask[vx + dim[0] * (vy + dim[1] * vz)] == expected);
+                }
+            }
+        }
+    }
+}
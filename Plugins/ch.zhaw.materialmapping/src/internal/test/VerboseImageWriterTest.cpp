@@ -0,0 +1,93 @@
+#include "catch.hpp"
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "../VerboseImageWriter.h"
+
+namespace {
+    // voxel value encodes its index: x + 100 * y + 10000 * z
+    vtkSmartPointer<vtkImageData> createImage(const int _extent[6]) {
+        auto image = vtkSmartPointer<vtkImageData>::New();
+        image->SetExtent(const_cast<int *>(_extent));
+        image->SetOrigin(1, 2, 3);
+        image->SetSpacing(0.5, 0.5, 2);
+        image->AllocateScalars(VTK_FLOAT, 1);
+        auto scalars = static_cast<float *>(image->GetScalarPointer());
+        for (auto z = _extent[4]; z <= _extent[5]; ++z) {
+            for (auto y = _extent[2]; y <= _extent[3]; ++y) {
+                for (auto x = _extent[0]; x <= _extent[1]; ++x) {
+                    *scalars++ = x + 100 * y + 10000 * z;
+                }
+            }
+        }
+        return image;
+    }
+
+    float getValue(vtkImageData *_image, int _x, int _y, int _z) {
+        int extent[6];
+        _image->GetExtent(extent);
+        auto nx = extent[1] - extent[0] + 1, ny = extent[3] - extent[2] + 1;
+        auto i = (_x - extent[0]) + nx * ((_y - extent[2]) + ny * (_z - extent[4]));
+        return static_cast<float *>(_image->GetScalarPointer())[i];
+    }
+
+    void requireExtent(vtkImageData *_image, int _x0, int _x1, int _y0, int _y1, int _z0, int _z1) {
+        int extent[6];
+        _image->GetExtent(extent);
+        REQUIRE(extent[0] == _x0);
+        REQUIRE(extent[1] == _x1);
+        REQUIRE(extent[2] == _y0);
+        REQUIRE(extent[3] == _y1);
+        REQUIRE(extent[4] == _z0);
+        REQUIRE(extent[5] == _z1);
+    }
+}
+
+TEST_CASE("VerboseImageWriter snapshot"){
+    const int extent[6] = {-3, 6, 2, 9, 0, 4};
+    auto image = createImage(extent);
+
+    SECTION("full copy"){
+        auto snapshot = VerboseImageWriter::createSnapshot(image, nullptr, 1);
+        requireExtent(snapshot, -3, 6, 2, 9, 0, 4);
+        REQUIRE(snapshot->GetSpacing()[2] == 2);
+        REQUIRE(getValue(snapshot, -3, 2, 0) == -3 + 200);
+        REQUIRE(getValue(snapshot, 6, 9, 4) == 6 + 900 + 40000);
+    }
+
+    SECTION("region of interest"){
+        const int roi[6] = {0, 100, 4, 5, -10, 1};
+        auto snapshot = VerboseImageWriter::createSnapshot(image, roi, 1);
+        requireExtent(snapshot, 0, 6, 4, 5, 0, 1);
+        for (auto z = 0; z <= 1; ++z) {
+            for (auto y = 4; y <= 5; ++y) {
+                for (auto x = 0; x <= 6; ++x) {
+                    REQUIRE(getValue(snapshot, x, y, z) == x + 100 * y + 10000 * z);
+                }
+            }
+        }
+    }
+
+    SECTION("decimation keeps the voxel positions"){
+        auto snapshot = VerboseImageWriter::createSnapshot(image, nullptr, 2);
+        requireExtent(snapshot, -1, 3, 1, 4, 0, 2);
+        REQUIRE(snapshot->GetOrigin()[0] == 1);
+        REQUIRE(snapshot->GetSpacing()[0] == 1);
+        REQUIRE(snapshot->GetSpacing()[2] == 4);
+        for (auto z = 0; z <= 2; ++z) {
+            for (auto y = 1; y <= 4; ++y) {
+                for (auto x = -1; x <= 3; ++x) {
+                    REQUIRE(getValue(snapshot, x, y, z) == 2 * x + 200 * y + 20000 * z);
+                }
+            }
+        }
+    }
+
+    SECTION("empty region"){
+        const int roi[6] = {7, 10, 2, 9, 0, 4};
+        REQUIRE(VerboseImageWriter::createSnapshot(image, roi, 1) == nullptr);
+        const int thin[6] = {-3, 6, 3, 3, 0, 4};
+        REQUIRE(VerboseImageWriter::createSnapshot(image, thin, 2) == nullptr);
+    }
+}